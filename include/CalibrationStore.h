@@ -0,0 +1,61 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CALIBRATION_STORE_H
+#define CALIBRATION_STORE_H
+
+#include <Arduino.h>
+
+#include "GlobalConsts.h"
+
+// Bump whenever CalibrationData changes
+#define CALIBRATION_VERSION 1
+
+struct CalibrationData {
+    // MPU6050 active offsets
+    int16_t accelOffset[3];
+    int16_t gyroOffset[3];
+
+    uint16_t minRead[N_OF_SENSORS];
+    uint16_t maxRead[N_OF_SENSORS];
+    uint16_t sensorsThreshold[N_OF_SENSORS];
+};
+
+/*
+    Keeps the gyro and sensor calibration in NVS so it survives a reset.
+
+    The data is stored with a version and a CRC, anything that does not
+    match is treated as missing.
+*/
+class CalibrationStore {
+   public:
+    // Returns TRUE if valid data was found
+    bool load(CalibrationData& data);
+
+    bool save(const CalibrationData& data);
+
+    // Erases the stored data, forcing a calibration on the next boot
+    void clear();
+
+   private:
+    struct StoredCalibration {
+        uint16_t version;
+        CalibrationData data;
+        uint32_t crc;
+    };
+
+    static uint32_t calculateCrc(const StoredCalibration& stored);
+};
+
+#endif  // CALIBRATION_STORE_H
@@ -0,0 +1,52 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <Arduino.h>
+
+/*
+    Time source of the control logic, in microseconds since boot.
+
+    LineFollower reads it once at the start of each tick and hands that
+    timestamp to everything the tick runs, so the whole tick sees one
+    time and a host test can drive it with ManualClock.
+*/
+class Clock {
+   public:
+    virtual ~Clock() {}
+
+    virtual int64_t now() = 0;
+};
+
+// esp_timer, the time base of micros() and of the sampler and gyro timestamps
+class SystemClock : public Clock {
+   public:
+    int64_t now() override;
+};
+
+// Only moves when told to
+class ManualClock : public Clock {
+   public:
+    int64_t now() override;
+
+    void set(int64_t timestamp);
+    void advance(int64_t microseconds);
+
+   private:
+    int64_t time = 0;
+};
+
+#endif
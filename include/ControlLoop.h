@@ -0,0 +1,89 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CONTROL_LOOP_H
+#define CONTROL_LOOP_H
+
+#include <Arduino.h>
+
+#include "GlobalConsts.h"
+
+struct ControlLoopStats {
+    // Number of ticks executed since the last reset
+    uint32_t ticks = 0;
+
+    // Timer periods that elapsed without the tick running
+    uint32_t missedDeadlines = 0;
+
+    // Ticks that took longer than one period to execute
+    uint32_t overruns = 0;
+
+    // Measured time between the start of two consecutive ticks (us)
+    uint32_t minPeriod = UINT32_MAX;
+    uint32_t maxPeriod = 0;
+
+    // Largest absolute deviation from the nominal period (us)
+    uint32_t maxJitter = 0;
+
+    // Longest tick execution time (us)
+    uint32_t maxExecutionTime = 0;
+};
+
+/*
+    Runs a tick function at a fixed rate from a dedicated FreeRTOS task.
+
+    The task is woken by a periodic esp_timer, so the period does not
+    depend on how long the tick itself took.
+*/
+class ControlLoop {
+   public:
+    typedef void (*TickFunction)();
+
+    ControlLoop(const char* name, TickFunction tickFunction, uint16_t rateHz);
+
+    /*
+        Creates the task pinned to a core and starts the timer
+
+        Returns FALSE on failure
+    */
+    bool begin(UBaseType_t priority, BaseType_t core, uint32_t stackSize);
+
+    void resetStats();
+
+    // Returns a copy of the timing statistics
+    ControlLoopStats getStats();
+
+    void printStats();
+
+    uint32_t getPeriodMicros();
+
+   private:
+    static void timerCallback(void* arg);
+    static void taskEntry(void* arg);
+
+    void taskLoop();
+
+    const char* _name;
+    TickFunction _tickFunction;
+    uint32_t _periodMicros;
+
+    TaskHandle_t _taskHandle = NULL;
+    esp_timer_handle_t _timerHandle = NULL;
+
+    portMUX_TYPE _statsMux = portMUX_INITIALIZER_UNLOCKED;
+    ControlLoopStats _stats;
+    bool _shouldResetStats = false;
+};
+
+#endif  // CONTROL_LOOP_H
@@ -0,0 +1,63 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FILTERED_PID_H
+#define FILTERED_PID_H
+
+#include <Arduino.h>
+
+#include "GlobalConsts.h"
+
+/*
+    PID that integrates and differentiates over the measured time of each
+    tick instead of assuming a fixed period.
+
+    The gains keep the units of a PIDestal running without delta time at
+    CONTROL_LOOP_RATE_HZ, so the profiles work unchanged: the integral
+    sums the error per nominal tick and the derivative is the change of a
+    nominal tick.
+
+    The derivative is taken from the measurement, so a new setpoint or new
+    gains do not kick the output, and it goes through a first order low
+    pass of PID_DERIVATIVE_FILTER_S. While the output is saturated the
+    integral stops growing in the direction that saturated it
+*/
+class FilteredPid {
+   public:
+    // Gains as kp, ki, kd, like SpeedProfile::sensorGains
+    void setGains(const float gains[3]);
+
+    // Forgets the integral and the last measurement, called when a run starts
+    void reset();
+
+    /*
+        error is the setpoint minus the measurement, shaped if needed, dt
+        the time since the last call (s). isSaturated tells whether the
+        last output could not be applied in full
+    */
+    float calculate(float error, float measurement, float dt, bool isSaturated);
+
+    float kp = 0;
+    float ki = 0;
+    float kd = 0;
+
+   private:
+    float integral = 0;
+    float derivative = 0;
+    float lastMeasurement = 0;
+    float lastOutput = 0;
+    bool hasMeasurement = false;
+};
+
+#endif  // FILTERED_PID_H
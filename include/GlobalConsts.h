@@ -18,7 +18,10 @@
 // Remove this to not compile the prints
 #define SERIAL_DEBUG
 
+// The native simulation has no BLE stack
+#ifndef NATIVE_SIM
 #define USE_BLUETOOTH
+#endif
 
 // Remove this to allow the robot to control the LED array
 #define LED_ALWAYS_ON
@@ -26,4 +29,227 @@
 // Number of sensors on the array
 #define N_OF_SENSORS 8
 
+// Time given to the multiplexer output to settle after switching channels
+#define MPLX_SETTLE_TIME_US 1
+
+/*
+    ADC continuous mode settings used when the sensors are read as analog
+
+    Each sensor costs the conversions still in flight when the channel
+    switches, at most ANALOG_CONVERSIONS_PER_DMA_FRAME, plus
+    ANALOG_OVERSAMPLING new ones. At 80kHz a scan of the 8 sensors takes
+    about 0.6ms, a new frame every 1.6 control ticks or so
+*/
+#define ANALOG_SAMPLE_RATE_HZ 80000
+// Conversions averaged into each sensor reading
+#define ANALOG_OVERSAMPLING 4
+// Conversions the driver hands over at once, also the most discarded after a switch
+#define ANALOG_CONVERSIONS_PER_DMA_FRAME 2
+
+#define ANALOG_SAMPLER_TASK_PRIORITY 5
+#define ANALOG_SAMPLER_TASK_STACK_SIZE 4096
+#define ANALOG_SAMPLER_TASK_CORE 0
+
+/*
+    Uncomment to calculate the line position as a weighted centroid of the
+    calibrated analog readings instead of averaging the processed sensors
+
+    Requires analog sensors and calibrated min/max readings
+*/
+// #define USE_ANALOG_CENTROID
+
+// Centroid weights are Q8, 256 means the sensor is fully on the line
+// Weight ignored on every sensor, rejects the background
+#define CENTROID_NOISE_FLOOR 64
+// Total weight needed to consider the line as seen
+#define CENTROID_MIN_WEIGHT 96
+
+/*
+    Uncomment to steer from the LineEstimator, which fuses the sensors with
+    the gyro, instead of switching to the gyro PID when the line is lost
+*/
+// #define USE_LINE_ESTIMATOR
+
+/*
+    Uncomment to turn along the arc through the line under the bar, with
+    the gyro PID correcting the rotation, instead of the sensor PID
+*/
+// #define USE_PURE_PURSUIT
+
+/*
+    Uncomment to steer from the estimated offset and heading of the line,
+    needs USE_LINE_ESTIMATOR
+*/
+// #define USE_STATE_FEEDBACK
+
+// Uncomment to lower the forward output before a motor saturates, keeping the whole steering
+// #define USE_STEERING_FIRST_MIXER
+
+// Sensor bar geometry, the bar is centered on the robot
+#define SENSOR_PITCH_M 0.012f
+// From the wheel axis to the sensors
+#define SENSOR_BAR_DISTANCE_M 0.08f
+// Between the wheels
+#define WHEEL_TRACK_M 0.13f
+
+// Pure pursuit turns as if it went at least this fast, otherwise it cannot start turning (m/s)
+#define PURE_PURSUIT_MIN_SPEED_M_S 0.3f
+
+// Standard deviation of a sensor array position (m)
+#define LINE_ESTIMATOR_SENSOR_NOISE_M 0.004f
+// Random walk of each state per square root second
+#define LINE_ESTIMATOR_OFFSET_NOISE 0.01f
+#define LINE_ESTIMATOR_HEADING_NOISE 0.5f
+#define LINE_ESTIMATOR_CURVATURE_NOISE 20.0f
+// The estimate never goes further than this from the bar center (m)
+#define LINE_ESTIMATOR_MAX_OFFSET_M 0.10f
+
+/*
+    Traction control, see SlipDetector. The model constants are fitted
+    from a run record with tools/decode_run.py --fit-slip
+*/
+// rotationSpeed reached at steady state per unit of right minus left output
+#define SLIP_YAW_GAIN 220.0f
+// Response time of the yaw rate to the motor outputs (s)
+#define SLIP_TIME_CONSTANT_S 0.04f
+// Residual allowed before a wheel is taken as slipping, in rotationSpeed units
+#define SLIP_MIN_RESIDUAL 20.0f
+// Extra residual allowed per unit of expected rotationSpeed
+#define SLIP_RELATIVE_RESIDUAL 0.3f
+// Ticks over the allowed residual before it counts as slip
+#define SLIP_CONFIRM_TICKS 5
+// Forward output taken off every tick while slipping
+#define SLIP_OUTPUT_DROP_STEP 0.005f
+// Forward output given back every tick once the wheels grip again
+#define SLIP_OUTPUT_RISE_STEP 0.002f
+
+// Launch control, see LaunchControl
+// Forward output at the start and time to climb from it to the cruise output (s)
+#define LAUNCH_START_OUTPUT 0.4f
+#define LAUNCH_RAMP_TIME_S 0.1f
+// Shape of the climb, below 1 it rises fast and then eases into the cruise output
+#define LAUNCH_RAMP_EXPONENT 0.5f
+// Wheels faster than the robot by this much are spinning (m/s)
+#define LAUNCH_SPIN_MARGIN_M_S 0.05f
+// Speed at which the ramp runs backwards while spinning, relative to forwards
+#define LAUNCH_BACKOFF_RATE 8.0f
+// The normal controller takes over at this fraction of the cruise speed
+#define LAUNCH_HANDOVER_FRACTION 0.9f
+#define LAUNCH_TIMEOUT_S 1.0f
+
+// Uncomment to measure the cycles spent on each stage of the control tick
+// #define ENABLE_PROFILER
+
+// Uncomment to print the cost of a sensor scan on startup
+// #define SENSOR_SCAN_BENCHMARK
+
+// Uncomment to print the cost of each steering policy combination on startup
+// #define STEERING_BENCHMARK
+
+// Default PID gains, both can be tuned over BLE
+#define SENSOR_PID_KP 1.8
+#define SENSOR_PID_KI 0.001
+#define SENSOR_PID_KD 11
+#define GYRO_PID_KP 0.90
+#define GYRO_PID_KI 0.00001
+#define GYRO_PID_KD 0.90
+
+/*
+    Uncomment to run both PIDs as FilteredPid, over the measured tick time
+    with a filtered derivative on the measurement and anti-windup
+*/
+// #define USE_FILTERED_PID
+
+// Time constant of the derivative low pass, smooths the steps of the sensor bar (s)
+#define PID_DERIVATIVE_FILTER_S 0.002f
+// Longest tick integrated as is (s)
+#define PID_MAX_DT_S 0.01f
+
+// A helper sensor must stay on a marker this long for it to count, shorter pulses are glitches
+#define HELPER_GLITCH_FILTER_US 500
+// Right helper marks are ignored while the bar sees the line this far right (0 to 7), the helper is on the line itself
+#define MARKER_MAX_LINE_POSITION 6.75f
+// A right helper mark counts only if the bar sees no crossing this long after it, shorter than RUN_STOP_DELAY_MS
+#define MARKER_CONFIRM_DELAY_MS 100
+// Helper sensor edges waiting for the control task, must be a power of two
+#define HELPER_EVENT_QUEUE_SIZE 32
+
+// Rate at which LineFollower::run is called by the control task
+#define CONTROL_LOOP_RATE_HZ 1000
+
+#define CONTROL_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define CONTROL_TASK_STACK_SIZE 8192
+// Sensors, gyro, PIDs and motors run alone on this core
+#define CONTROL_TASK_CORE 1
+
+// Time between a start request and the motors starting, enough to take the hand off the robot
+#define RUN_ARM_DELAY_MS 500
+// Time the robot keeps following the line after the finish marker
+#define RUN_STOP_DELAY_MS 200
+
+// Time given to sweep the robot over the line when calibrating analog sensors
+#define SENSOR_CALIBRATION_TIME_MS 3000
+
+// While running every analog reading moves the dark or light level of its sensor by 1/2^shift
+#define SENSOR_ADAPTATION_SHIFT 7
+// and the opposite level by 1/2^shift, a sensor stuck on one level slowly loses its contrast
+#define SENSOR_LEVEL_DECAY_SHIFT 13
+// Sensors with less than this between their dark and light levels are flagged and left alone
+#define SENSOR_MIN_CONTRAST 300
+
+#define GYRO_I2C_CLOCK_HZ 400000
+
+// MPU6050 digital low pass filter, 1 = 188Hz bandwidth with a 1kHz internal rate
+#define GYRO_DLPF_MODE 1
+// Output rate is 1kHz / (1 + divider) with the DLPF enabled
+#define GYRO_SAMPLE_RATE_DIVIDER 0
+#define GYRO_SAMPLE_RATE_HZ 1000
+
+#define GYRO_TASK_PRIORITY 10
+#define GYRO_TASK_STACK_SIZE 4096
+#define GYRO_TASK_CORE 0
+
+// 1 if the MPU6050 X axis points forward, -1 if it points backwards
+#define ACCEL_FORWARD_SIGN 1
+#define GRAVITY_M_S2 9.80665f
+
+// Speed of the robot with both motors at 1.0, used to estimate the distance
+#define MAX_WHEEL_SPEED_M_S 2.0f
+
+#define TRACK_MAP_SEGMENT_LENGTH_M 0.05f
+// 200m of track
+#define TRACK_MAP_MAX_SEGMENTS 4000
+// Segments averaged to each side when planning
+#define TRACK_MAP_CURVATURE_SMOOTHING 3
+
+// Limits used to plan the RACE mode speed profile
+#define RACE_MAX_SPEED_M_S 2.0f
+#define RACE_MIN_SPEED_M_S 0.6f
+#define RACE_MAX_LATERAL_ACCEL 6.0f
+#define RACE_MAX_BRAKING 4.0f
+#define RACE_MAX_ACCELERATION 3.0f
+// How far ahead the speed profile is read, covers the motors response
+#define RACE_LOOKAHEAD_M 0.10f
+
+// Ticks kept by the run recorder, 48 bytes each in PSRAM
+#define RUN_RECORDER_CAPACITY 65536
+
+// Rate of the BLE, buttons and LEDs task
+#define HOUSEKEEPING_RATE_HZ 200
+
+#define HOUSEKEEPING_TASK_PRIORITY 2
+#define HOUSEKEEPING_TASK_STACK_SIZE 8192
+#define HOUSEKEEPING_TASK_CORE 0
+
+// Control ticks between two telemetry samples, 5 streams at 200Hz
+#define TELEMETRY_DECIMATION 5
+// Samples waiting for the housekeeping task, must be a power of two
+#define TELEMETRY_QUEUE_SIZE 256
+// A packet is sent once full or when its first sample is this old
+#define TELEMETRY_MAX_LATENCY_MS 100
+// Notifications sent per housekeeping tick at most
+#define TELEMETRY_MAX_PACKETS_PER_TICK 1
+// Largest ATT MTU the telemetry packets are sized for, the central negotiates the actual one
+#define TELEMETRY_MTU 517
+
 #endif
\ No newline at end of file
@@ -19,8 +19,17 @@
 #include <I2Cdev.h>
 #include <Wire.h>
 
+#include <atomic>
+
 #include "GlobalConsts.h"
 #include "MPU6050.h"
+#include "SeqLock.h"
+#include "freertos/semphr.h"
+
+// Sensitivity at the ±1000 degrees/sec range set by initialize()
+#define GYRO_LSB_PER_DPS 32.8f
+// Sensitivity at the ±8g range set by initialize()
+#define ACCEL_LSB_PER_G 4096.0f
 
 struct Vec3 {
     int16_t x, y, z;
@@ -38,11 +47,35 @@ struct Vec3 {
     };
 };
 
+// A single gyro Z and accelerometer X reading
+struct GyroSample {
+    int16_t z;
+    int16_t accelX;
+
+    // esp_timer time (us) at which the sample was taken
+    int64_t timestamp;
+};
+
+struct GyroStats {
+    uint32_t samples;
+
+    // Samples per second since the acquisition started
+    float sampleRate;
+
+    // Time spent on each I2C read (us)
+    uint32_t meanReadLatency;
+    uint32_t maxReadLatency;
+};
+
 class Gyro {
    public:
-    Gyro();
+    /*
+        dataReadyPin is the GPIO wired to the MPU6050 INT pin, with -1 the
+        sensor is polled at GYRO_SAMPLE_RATE_HZ instead
+    */
+    Gyro(int8_t dataReadyPin = -1);
 
-    // Initializes the I2C connection
+    // Initializes the I2C connection and starts the acquisition task
     void initialize();
 
     /*
@@ -54,19 +87,62 @@ class Gyro {
     */
     bool calibrate();
 
+    // Copies the active MPU6050 offsets
+    void getOffsets(int16_t accelOffset[3], int16_t gyroOffset[3]);
+
+    // Loads previously calibrated offsets into the MPU6050
+    void setOffsets(const int16_t accelOffset[3], const int16_t gyroOffset[3]);
+
     // Prints the gyro and accel readings
     void printReadings();
 
-    // Updates the Accelerometer and Gyroscope vector
-    void update();
+    /*
+        Copies the latest sample taken by the acquisition task into
+        gyroscope.z and rotationSpeed, never waits for the I2C bus
+
+        Reads the sensor directly if the task could not be started, the
+        sample is then stamped with tickTime (us)
+    */
+    void update(int64_t tickTime);
 
-    // The only used parameter is the gyroscope z
+    GyroStats getStats();
+    void printStats();
+
+    // Only the gyroscope z and the accelerometer x are read from the sensor
     Vec3 accelerometer;
     Vec3 gyroscope;
 
+    // Degrees/sec at the ±250 scale, a quarter of the real rate, the gyro PID is tuned for it
     float rotationSpeed;
 
+    // Counter clockwise rate (rad/s)
+    float angularVelocity = 0;
+
+    // Along the direction of travel (m/s2), includes the tilt and any offset left by the calibration
+    float forwardAcceleration = 0;
+
+    // esp_timer time (us) of the sample in rotationSpeed
+    int64_t sampleTimestamp = 0;
+
    private:
+    static void dataReadyInterrupt(void* arg);
+    static void acquisitionEntry(void* arg);
+    void acquisitionLoop();
+
     MPU6050 accelGyro;
+
+    // Every access to the MPU6050 must hold this mutex
+    SemaphoreHandle_t i2cMutex = NULL;
+
+    TaskHandle_t acquisitionTask = NULL;
+    int8_t dataReadyPin = -1;
+
+    SeqLock<GyroSample> latestSample;
+
+    // Only written by the acquisition task
+    std::atomic<uint32_t> numberOfSamples{0};
+    std::atomic<uint32_t> totalReadLatency{0};
+    std::atomic<uint32_t> maxReadLatency{0};
+    int64_t acquisitionStartTime = 0;
 };
 #endif
\ No newline at end of file
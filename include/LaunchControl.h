@@ -0,0 +1,77 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LAUNCH_CONTROL_H
+#define LAUNCH_CONTROL_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "GlobalConsts.h"
+
+/*
+    Forward output of the first metres of a run.
+
+    The output climbs from LAUNCH_START_OUTPUT to the cruise output along
+    a power curve, progress^LAUNCH_RAMP_EXPONENT over LAUNCH_RAMP_TIME_S.
+    The speed the wheels should have, from the outputs and the motor lag,
+    is compared with the speed integrated from the accelerometer. While
+    the wheels are ahead by more than LAUNCH_SPIN_MARGIN_M_S they are
+    spinning and the curve runs backwards.
+
+    The launch ends once the robot reaches LAUNCH_HANDOVER_FRACTION of the
+    cruise speed, or after LAUNCH_TIMEOUT_S
+*/
+class LaunchControl {
+   public:
+    /*
+        Starts a launch from rest, restAcceleration is the forward
+        acceleration read while standing still
+    */
+    void begin(int64_t timestamp, float restAcceleration);
+
+    /*
+        Called every control tick while launching with the timestamp of the
+        tick (us), the output the controller cruises at and the measured forward
+        acceleration (m/s2). Returns the forward output to use
+    */
+    float update(int64_t timestamp, float cruiseOutput, float forwardAcceleration);
+
+    bool getIsLaunching();
+    bool getIsSpinning();
+
+    // Time taken to reach the cruise speed in the last launch (s), negative until then
+    float getLaunchTime();
+
+   private:
+    bool isLaunching = false;
+    bool isSpinning = false;
+
+    int64_t startTime = 0;
+    int64_t lastUpdateTime = 0;
+
+    // Position along the ramp (s), goes back while spinning
+    float curveTime = 0;
+
+    float restAcceleration = 0;
+    float bodySpeed = 0;
+    float wheelSpeed = 0;
+    float output = 0;
+
+    // Read by the housekeeping task
+    std::atomic<float> launchTime{-1};
+};
+
+#endif  // LAUNCH_CONTROL_H
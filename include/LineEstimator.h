@@ -0,0 +1,62 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LINE_ESTIMATOR_H
+#define LINE_ESTIMATOR_H
+
+#include <Arduino.h>
+
+#include "GlobalConsts.h"
+
+/*
+    Kalman filter tracking where the line is relative to the sensor bar.
+
+    State:
+        offset      line position from the bar center (m), positive to the left
+        heading     line direction relative to the robot (rad), positive to the left
+        curvature   line curvature (1/m), positive turning left
+
+    The gyro and the commanded speed move the state forward every tick,
+    the sensor array corrects it whenever it sees the line. While the line
+    is lost the offset keeps following the last known curve instead of
+    freezing at the edge of the bar.
+*/
+class LineEstimator {
+   public:
+    LineEstimator();
+
+    // Forgets the state, the line is assumed straight under the bar center
+    void reset();
+
+    /*
+        Moves the state dt seconds forward, speed (m/s) is the forward
+        speed and angularVelocity (rad/s) the counter clockwise rate
+    */
+    void predict(float dt, float speed, float angularVelocity);
+
+    // Measured line position from the bar center (m), positive to the left
+    void correct(float measuredOffset);
+
+    float getOffset();
+    float getHeading();
+    float getCurvature();
+
+   private:
+    float offset, heading, curvature;
+
+    // Covariance of the state, in the order above
+    float covariance[3][3];
+};
+
+#endif  // LINE_ESTIMATOR_H
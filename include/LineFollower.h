@@ -17,15 +17,27 @@
 
 #include <Arduino.h>
 
+#include <atomic>
+
+#include "CalibrationStore.h"
+#include "Clock.h"
 #include "GlobalConsts.h"
 #include "Gyro.h"
+#include "LaunchControl.h"
 #include "PIDestal.h"
+#include "ProfileStore.h"
+#ifdef USE_BLUETOOTH
 #include "PIDestalRemoteBLE.h"
+#endif
+#include "RunRecorder.h"
 #include "SensorArray.h"
+#include "SlipDetector.h"
+#include "Steering.h"
+#include "SpscQueue.h"
 #include "TB6612FNG.h"
-
-#define DEFAULT_MIN_MOTOR_OFFSET 0.7
-#define DEFAULT_MAX_MOTOR_OFFSET 1.0
+#include "Telemetry.h"
+#include "TelemetryBle.h"
+#include "TrackMap.h"
 
 float invertedMap(float input, float inMin, float inMax, float outMin, float outMax);
 
@@ -45,7 +57,51 @@ class LineFollower {
         SLOW,
         MEDIUM,
         FAST,
+        // Maps the first lap, then follows the planned speed profile
+        RACE,
+    };
+
+    /*
+        IDLE -> ARMED on a start request, RUNNING RUN_ARM_DELAY_MS later,
+        STOPPING at the finish line, BRAKED RUN_STOP_DELAY_MS later.
+        A request while ARMED, RUNNING or STOPPING goes back to IDLE,
+        one while BRAKED arms again
+    */
+    enum RunState {
+        // Motors coasting
+        IDLE,
+        // Counting down to the start, motors coasting
+        ARMED,
+        RUNNING,
+        // Past the finish line, still following it
+        STOPPING,
+        // Motors braking
+        BRAKED
+    };
+
+    // Level change of a helper sensor, pushed by its interrupt
+    struct HelperEvent {
+        // micros() of the edge
+        uint32_t timestamp;
+        HelperSensorSide sensorSide;
+        bool level;
     };
+
+    // Parameter changes sent from the housekeeping core to the control core
+    struct Command {
+        enum Type {
+            TOGGLE_MOTORS,
+            // Switches to mode and its profile, also sent when the profile is edited
+            SET_PROFILE,
+            RECALIBRATE,
+            CLEAR_TRACK_MAP
+        };
+
+        Type type;
+        Modes mode;
+        SpeedProfile profile;
+    };
+
     LineFollower(
         SensorArray& sensArrRef,
         Gyro& gyroRef,
@@ -54,6 +110,8 @@ class LineFollower {
         Tb6612fng& motorsRef,
 #ifdef USE_BLUETOOTH
         PIDestalRemoteBLE& remotePidRef,
+        PIDestal& remoteSensorPidRef,
+        PIDestal& remoteGyroPidRef,
 #endif
         uint8_t statusLed1,
         uint8_t statusLed2,
@@ -63,49 +121,216 @@ class LineFollower {
     // Sets up every component, should be called on the main setup function
     void initialize();
 
+    // Replaces the esp_timer clock, must be called before initialize()
+    void setClock(Clock& clockRef);
+
+    // Executes one control tick, called by the control task at CONTROL_LOOP_RATE_HZ
     void run();
 
+    /*
+        Processes BLE, buttons and the mode LEDs, called by the housekeeping task
+
+        Must never run on the same core as run()
+    */
+    void runHousekeeping();
+
+    /*
+        Writes the ticks recorded during the last run, see RunRecorder
+
+        Returns FALSE while a run is armed or in progress, must not be called
+        from the control task
+    */
+    bool dumpRunRecord(Print& output);
+
     // Prints all parameters
     void printAll();
     void printAll2();
 
+    /*
+        Packs the telemetry samples of the control task, see
+        TelemetryStream::readPacket. May only be called from the
+        housekeeping task, which also sends them over BLE
+    */
+    uint16_t readTelemetryPacket(uint8_t* buffer, uint16_t capacity);
+
+    // Times a wheel lost traction during the last run, may be called from any task
+    uint32_t getSlipEvents();
+
+    // Time from the start to the cruise speed in the last run (s), negative if not reached, may be called from any task
+    float getLaunchTime();
+
+    // Requests a start/stop, may only be called from the housekeeping task
     void toggleMotorsAreActive();
 
-    void triggeredInterruptRising(HelperSensorSide sensorSide);
-    void triggeredInterruptFalling(HelperSensorSide sensorSide);
+    // May be called from any task
+    RunState getRunState();
 
+    /*
+        Queues an edge of a helper sensor, called from its GPIO interrupt
+        with the level read right after the edge and its micros(), on the
+        time base of the clock. The markers are counted by the control task.
+
+        Both helper interrupts must be attached from the same core, the
+        queue only takes one producer
+    */
+    void onHelperEdge(HelperSensorSide sensorSide, bool level, uint32_t timestamp);
+
+    // Requests a mode change, may only be called from the housekeeping task
     void changeMode(Modes newMode);
 
+    // Profile used by a mode, may only be called from the housekeeping task
+    SpeedProfile getProfile(Modes mode);
+
+    /*
+        Replaces the profile of a mode, applied on the next tick if the mode
+        is selected and saved to NVS once the motors stop. May only be
+        called from the housekeeping task
+    */
+    void setProfile(Modes mode, const SpeedProfile& profile);
+
+    /*
+        Requests a new gyro and sensor calibration, only taken while IDLE or
+        BRAKED, which leaves the robot IDLE. May only be called from the
+        housekeeping task
+    */
+    void requestCalibration();
+
+    // Forgets the recorded track, may only be called from the housekeeping task
+    void clearTrackMap();
+
    private:
     /*
-        Receives an array of booleans representing the current
-        reading of each sensor and returns the average of them.
+        Pushes a command into the mailbox, only the housekeeping task
+        may produce commands
     */
-    float calculateInput(bool sensorsDigital[N_OF_SENSORS]);
-    float calculateTargetRotSpeed(float error);
+    void postCommand(const Command& command);
+
+    // Applies every pending command, called at the start of each tick
+    void processCommands();
+
+    /*
+        Drains the helper sensor edges and counts every marker seen for
+        at least HELPER_GLITCH_FILTER_US
+    */
+    void processHelperEvents();
+
+    /*
+        Holds a right helper mark, timestamp is the micros() it was reached.
+        confirmMarker counts it MARKER_CONFIRM_DELAY_MS later, unless a
+        crossing came within crossingTimeThreshold before it or by then, or
+        the bar had the line under the helper meanwhile
+    */
+    void holdMarker(uint32_t timestamp);
+    void confirmMarker();
+
+    // Start and finish line logic, distance is lapDistance when the marker was reached
+    void countMarker(uint32_t timestamp, float distance);
+
+    // Moves the run state on a start/stop request, runs on the control task
+    // A start is ignored until the robot is calibrated
+    void applyToggleMotorsAreActive();
+
+    // Enters a run state, the time in it is counted from this tick
+    void setRunState(RunState newState);
+
+    // Ends the countdown and the stop once their time is up
+    void updateRunState();
+
+    // Resets the per run state as the motors start
+    void startRun();
+
+    void updateModeLeds();
+
+    // Sends the profile of the selected mode to the control task
+    void postProfile();
+
+    // Applies a SET_PROFILE command on the control task
+    void applyProfile(Modes mode, const SpeedProfile& profile);
+
+    // Applies the calibration stored in NVS, returns FALSE if there is none
+    bool loadCalibration();
+
+    void saveCalibration();
+
+    /*
+        Advances the calibration, first the gyro then, for analog sensors,
+        a SENSOR_CALIBRATION_TIME_MS sweep over the line
+    */
+    void runCalibration();
+
+#ifdef USE_BLUETOOTH
+    // Writes the gains edited over BLE into the selected profile whenever they change
+    void syncRemoteGains();
+
+    // Shows the gains of the selected profile on the BLE PIDs
+    void loadRemoteGains();
+
+    /*
+        Applies a "name=value" edit of the selected profile received over
+        BLE, see ProfileStore::findField. A value that does not parse or is
+        refused by ProfileStore::isValidValue is answered with an error
+        and leaves the profile untouched
+    */
+    void editProfileField(const char* edit);
+#endif
+
+    /*
+        Receives the processed sensors packed as a mask and returns the
+        average index of the ones that see the line.
+
+        With USE_ANALOG_CENTROID the position comes from the calibrated
+        analog centroid, the mask is still used to detect crossings.
+    */
+    float calculateInput(uint8_t processedMask);
+
+    // Runs the steering policies on this tick's line error and gyro reading
+    void updateSteering();
+
     void updateMotors();
 
     void updateButtons();
 
-    float calculateSensorReadingError(float error);
-
     float calculateMotorOffset();
 
     void endRun();
 
+    // Drops a lap started on a marker that was not confirmed
+    void abandonLap();
+
     void switchMode();
 
     bool isButtonPressValid();
 
-    void updateMode();
-
     float getTurboOffset(float offset);
 
+    /*
+        Tracks the distance since the start line and records the track map
+        on a RACE mode mapping lap
+    */
+    void updateTrackMap();
+
+    /*
+        Closes the lap, a recorded map is planned if the lap reached the
+        finish line and cleared otherwise
+    */
+    void finishLap();
+
+    void recordTick();
+
+    // Queues every TELEMETRY_DECIMATION tick on the telemetry stream
+    void streamTick();
+
     SensorArray* sensorArray;
-    PIDestal* sensorPid;
-    PIDestal* gyroPid;
 #ifdef USE_BLUETOOTH
     PIDestalRemoteBLE* remotePid;
+
+    // PIDs edited by the BLE stack, never used for control
+    PIDestal* remoteSensorPid;
+    PIDestal* remoteGyroPid;
+
+    // Last gains written into the selected profile
+    float postedSensorGains[3];
+    float postedGyroGains[3];
 #endif
     Gyro* gyro;
     Tb6612fng* motors;
@@ -118,27 +343,32 @@ class LineFollower {
     float pidResult = 0;
 
     float gyroPidResult = 0;
-    float errorGain = 0.01;
 
-    float leftMotorOutput;
-    float rightMotorOutput;
+    float leftMotorOutput = 0;
+    float rightMotorOutput = 0;
     bool motorsAreActive = false;
-    unsigned long lastPressedButtonTime = 0;
+    // Time (us) of the last valid button press and of the current housekeeping tick
+    int64_t lastPressedButtonTime = 0;
+    int64_t housekeepingTime = 0;
 
-    // Millis time of the last intersection
-    unsigned long lastCrossingTime = 0;
+    // Time (us) of the last intersection
+    int64_t lastCrossingTime = 0;
+    // Markers closer than this (ms) to an intersection are ignored
     uint16_t crossingTimeThreshold = 500;
     uint8_t numberOfRightSignals = 0;
     uint8_t totalRightSignals = 2;
 
+    // Right helper mark waiting for the crossing window to pass
+    bool isMarkerPending = false;
+    uint32_t pendingMarkerTime = 0;
+    float pendingMarkerDistance = 0;
+
     float motorOffset = 0.5;
     float motorClamp = 1;
-    float minMotorOffset = DEFAULT_MIN_MOTOR_OFFSET;
-    float maxMotorOffset = DEFAULT_MAX_MOTOR_OFFSET;
     float speedMultiplier = 1.0;
 
     float rotSpeed;        // Speed of rotation
-    float rotSpeedTarget;  // Speed of rotation
+    float rotSpeedTarget = 0;  // Speed of rotation
     float rotSpeedThreshold = 90.0f;
 
     uint8_t
@@ -150,24 +380,92 @@ class LineFollower {
     bool button1 = false;
     bool button2 = true;
 
-    bool gyroWasCalibrated = false;
+    // Set once the gyro and sensors were calibrated or loaded from NVS
+    std::atomic<bool> isCalibrated{false};
+    bool isCalibratingSensors = false;
+    int64_t sensorCalibrationStartTime = 0;
+
+    CalibrationStore calibrationStore;
+
+    RunRecorder runRecorder;
+
+    SystemClock systemClock;
+    Clock* clock = &systemClock;
+
+    // Read from the clock once at the start of run(), the only time the tick uses (us)
+    int64_t tickStartTime = 0;
+
+    std::atomic<RunState> runState{IDLE};
+    // tickStartTime of the last run state change
+    int64_t runStateSince = 0;
+
+    // Not IDLE or BRAKED, the run record and the profiles are left alone
+    std::atomic<bool> isRunning{false};
+
+    // Estimator, controller and mixer picked by the USE_ flags, see Steering.h
+    LineFollowerSteering steering;
+    int64_t lastSteeringUpdate = 0;
+
+    LaunchControl launchControl;
+    SlipDetector slipDetector;
+    // Ceiling of the forward output from a slip until the wheels recover, see updateMotors
+    float tractionLimit = 0;
+    bool isTractionLimited = false;
+
+    TelemetryStream telemetry;
+    uint8_t ticksSinceTelemetry = 0;
+#ifdef USE_BLUETOOTH
+    TelemetryBle telemetryBle;
+#endif
+
+    TrackMap trackMap;
+    bool lapStarted = false;
+    // The lap reached the finish line, only then is a recorded map planned
+    bool isLapFinished = false;
+    bool isUsingSpeedProfile = false;
+
+    // Estimated from the motor outputs
+    float lapDistance = 0;
+    // lapDistance at the finish marker, the map ends there
+    float finishedLapDistance = 0;
+    int64_t lastTrackMapUpdate = 0;
 
     bool isOutOfLine = true;
-    unsigned long outOfLineStartingTime = 0;
+    int64_t outOfLineStartingTime = 0;
 
     ControllerType currentController = SENSOR;
 
     bool lastRightHelper = false;
-    unsigned long crossedFinishLine = 0;
-    bool shouldStop = false;
 
-    unsigned long lastInterrupt = 0;
+    Modes currentMode = MEDIUM;
 
-    bool doOnceStart = true;
+    // Profile of currentMode, only touched by the control task
+    SpeedProfile activeProfile = DEFAULT_PROFILES[MEDIUM];
 
-    Modes currentMode = MEDIUM;
+    // Every profile, owned by the housekeeping task
+    SpeedProfile profiles[N_OF_PROFILES];
+    ProfileStore profileStore;
 
-    unsigned long interruptRisingTime = 0;
+    // Edited since the last save
+    bool profilesAreDirty = false;
+
+    // Mode chosen on the housekeeping side, mirrors currentMode once applied
+    Modes selectedMode = MEDIUM;
+    bool modeLedsAreValid = false;
+
+    SpscQueue<Command, 16> commandQueue;
+
+    SpscQueue<HelperEvent, HELPER_EVENT_QUEUE_SIZE> helperEvents;
+
+    // Edges lost because the queue was full
+    std::atomic<uint32_t> droppedHelperEvents{0};
+
+    struct HelperState {
+        bool isOnLine = false;
+        bool wasCounted = true;
+        uint32_t lineReachedAt = 0;
+    };
+    HelperState helperStates[2];
 };
 
 #endif  // LINE_FOLLOWER_H
\ No newline at end of file
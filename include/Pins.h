@@ -0,0 +1,45 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINS_H
+#define PINS_H
+
+#define MIO 9
+#define MPLX_S0 13
+#define MPLX_S1 14
+#define MPLX_S2 21
+#define LED_SELEC_1 10
+#define LED_SELEC_2 12
+#define LEFT_HELPER_SENS 1
+#define RIGHT_HELPER_SENS 8
+
+#define SDA_PIN 16
+#define SCL_PIN 15
+// GPIO wired to the MPU6050 INT pin, -1 polls the gyro instead
+#define GYRO_INT_PIN -1
+
+#define STATUS_LED_1 41
+#define STATUS_LED_2 42
+#define INPUT_BTN_1 19
+#define INPUT_BTN_2 20
+
+#define PWM_A 38
+#define AIN_2 45
+#define AIN_1 48
+#define STBY 39
+#define BIN_1 5
+#define BIN_2 4
+#define PWM_B 2
+
+#endif  // PINS_H
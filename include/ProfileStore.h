@@ -0,0 +1,115 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PROFILE_STORE_H
+#define PROFILE_STORE_H
+
+#include <Arduino.h>
+
+#include "GlobalConsts.h"
+
+// Bump whenever SpeedProfile changes
+#define PROFILE_VERSION 1
+
+// One profile for each LineFollower::Modes
+#define N_OF_PROFILES 4
+
+// calculateSensorReadingError breakpoints, the last range has no upper end
+#define N_OF_ERROR_RANGES 4
+
+// Largest values a "name=value" edit may set, every field is at least 0
+#define PROFILE_MAX_TURBO 3.0f
+#define PROFILE_MAX_GAIN 100.0f
+
+// Everything that changes between modes
+struct SpeedProfile {
+    float minMotorOffset;
+    float maxMotorOffset;
+
+    // The motor offset is multiplied by turboFactor while the sensor error is under turboMaxError
+    float turboFactor;
+    float turboMaxError;
+
+    float sensorGains[3];
+    float gyroGains[3];
+
+    // Weight of the gyro PID while the line is lost
+    float errorGain;
+
+    /*
+        The sensor error is multiplied by errorShapeGains[i] in the range
+        ending at errorBreakpoints[i], the last gain covers everything above
+    */
+    float errorBreakpoints[N_OF_ERROR_RANGES - 1];
+    float errorShapeGains[N_OF_ERROR_RANGES];
+};
+
+constexpr SpeedProfile makeDefaultProfile(float minMotorOffset, float maxMotorOffset) {
+    return SpeedProfile{
+        minMotorOffset,
+        maxMotorOffset,
+        1.5f,
+        1.0f,
+        {SENSOR_PID_KP, SENSOR_PID_KI, SENSOR_PID_KD},
+        {GYRO_PID_KP, GYRO_PID_KI, GYRO_PID_KD},
+        0.01f,
+        {1.0f, 2.0f, 3.0f},
+        {1.1f, 1.0f, 1.0f, 1.1f}};
+}
+
+// SLOW, MEDIUM, FAST and RACE, used until profiles are saved to NVS
+constexpr SpeedProfile DEFAULT_PROFILES[N_OF_PROFILES] = {
+    makeDefaultProfile(0.6f, 0.6f),
+    makeDefaultProfile(0.4f, 0.8f),
+    makeDefaultProfile(0.7f, 1.0f),
+    // Only used on the mapping lap
+    makeDefaultProfile(0.4f, 0.8f)};
+
+/*
+    Keeps the speed profiles in NVS, with a version and a CRC like
+    CalibrationStore. Writing to flash stalls both cores, never save
+    while the motors are active
+*/
+class ProfileStore {
+   public:
+    // Returns TRUE if valid profiles were found, else profiles is left untouched
+    bool load(SpeedProfile profiles[N_OF_PROFILES]);
+
+    bool save(const SpeedProfile profiles[N_OF_PROFILES]);
+
+    /*
+        Returns the field of a profile with the given name, as used by
+        the BLE "name=value" edits, or NULL if there is none
+    */
+    static float* findField(SpeedProfile& profile, const char* name);
+
+    /*
+        Returns TRUE if value is finite and within the range of the field
+        named name: the offsets up to the full output, the turbo up to
+        PROFILE_MAX_TURBO, the error limits across the sensor bar and the
+        gains up to PROFILE_MAX_GAIN
+    */
+    static bool isValidValue(const char* name, float value);
+
+   private:
+    struct StoredProfiles {
+        uint16_t version;
+        SpeedProfile profiles[N_OF_PROFILES];
+        uint32_t crc;
+    };
+
+    static uint32_t calculateCrc(const StoredProfiles& stored);
+};
+
+#endif  // PROFILE_STORE_H
@@ -0,0 +1,93 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+#include "GlobalConsts.h"
+
+enum ProfilerStage {
+    PROFILE_TICK,
+    PROFILE_SENSORS,
+    PROFILE_GYRO,
+    PROFILE_PID,
+    PROFILE_MOTORS,
+    NUMBER_OF_PROFILER_STAGES
+};
+
+#ifdef ENABLE_PROFILER
+
+#include <atomic>
+
+#include "SeqLock.h"
+
+// Bucket i counts the measurements from 2^i to 2^(i+1) - 1 cycles
+#define PROFILER_NUMBER_OF_BUCKETS 32
+
+struct ProfilerStageStats {
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t histogram[PROFILER_NUMBER_OF_BUCKETS];
+};
+
+/*
+    Measures the CPU cycles spent on each stage of the control tick.
+
+    begin()/end() are only called by the control task, report() may run
+    on any other task without ever making the control task wait.
+*/
+class Profiler {
+   public:
+    static inline void begin(ProfilerStage stage) {
+        startCycles[stage] = ESP.getCycleCount();
+    }
+
+    static inline void end(ProfilerStage stage) {
+        add(stage, ESP.getCycleCount() - startCycles[stage]);
+    }
+
+    // Prints min/max/mean and the histogram of every stage
+    static void report(Print& output);
+
+    // Clears the statistics before the next tick
+    static void requestReset();
+
+   private:
+    static void add(ProfilerStage stage, uint32_t cycles);
+
+    static uint32_t startCycles[NUMBER_OF_PROFILER_STAGES];
+
+    // Only touched by the control task
+    static ProfilerStageStats stats[NUMBER_OF_PROFILER_STAGES];
+
+    // Copies of stats published after every update, read by report()
+    static SeqLock<ProfilerStageStats> snapshots[NUMBER_OF_PROFILER_STAGES];
+    static std::atomic<bool> shouldReset;
+};
+
+#define PROFILE_BEGIN(stage) Profiler::begin(stage)
+#define PROFILE_END(stage) Profiler::end(stage)
+
+#else
+
+#define PROFILE_BEGIN(stage)
+#define PROFILE_END(stage)
+
+#endif  // ENABLE_PROFILER
+
+#endif  // PROFILER_H
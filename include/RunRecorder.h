@@ -0,0 +1,98 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RUN_RECORDER_H
+#define RUN_RECORDER_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "GlobalConsts.h"
+
+#define RUN_RECORD_VERSION 1
+
+// Bits of RunRecord::flags
+#define RUN_RECORD_GYRO_CONTROLLER (1 << 0)
+#define RUN_RECORD_OUT_OF_LINE (1 << 1)
+#define RUN_RECORD_LEFT_HELPER (1 << 2)
+#define RUN_RECORD_RIGHT_HELPER (1 << 3)
+#define RUN_RECORD_SLIP (1 << 4)
+
+/*
+    State of one control tick, little endian, 48 bytes.
+
+    Any change here must bump RUN_RECORD_VERSION and tools/decode_run.py
+*/
+struct __attribute__((packed)) RunRecord {
+    // Clock time (us) at the start of the tick, esp_timer on the robot, low 32 bits
+    uint32_t timestamp;
+    uint16_t sensorRaw[N_OF_SENSORS];
+    // SensorArray::processedMask
+    uint8_t sensorProcessed;
+    uint8_t flags;
+    uint16_t reserved;
+    float sensorInput;
+    float rotSpeed;
+    float sensorPidResult;
+    float gyroPidResult;
+    float leftMotorOutput;
+    float rightMotorOutput;
+};
+
+static_assert(sizeof(RunRecord) == 48, "RunRecord layout is part of the dump format");
+
+/*
+    Ring buffer of RunRecord in PSRAM, filled by the control task during a
+    run and dumped afterwards.
+
+    Dump format, little endian:
+        char[4]   magic "VDRR"
+        uint16    RUN_RECORD_VERSION
+        uint16    sizeof(RunRecord)
+        uint32    number of records
+        uint32    records overwritten because the buffer was full
+        records   oldest first
+        uint32    CRC32 of the records
+*/
+class RunRecorder {
+   public:
+    // Allocates RUN_RECORDER_CAPACITY records in PSRAM, returns FALSE on failure
+    bool initialize();
+
+    // Discards every record, only called by the control task
+    void clear();
+
+    /*
+        Copies a record into the buffer, only called by the control task
+
+        Never blocks, records are dropped while a dump is in progress
+    */
+    void record(const RunRecord& runRecord);
+
+    // Writes the dump, must not be called by the control task
+    void dump(Print& output);
+
+   private:
+    RunRecord* records = NULL;
+
+    // Total records written since the last clear
+    std::atomic<uint32_t> numberOfRecords{0};
+    std::atomic<bool> isDumping{false};
+
+    // Set by record() while it writes, dump() waits for it to clear
+    std::atomic<bool> isRecording{false};
+};
+
+#endif  // RUN_RECORDER_H
@@ -17,7 +17,48 @@
 
 #include <Arduino.h>
 
+
 #include "GlobalConsts.h"
+#include "SensorPatterns.h"
+#include "SeqLock.h"
+
+/*
+    Sensor index connected to each multiplexer channel
+
+    S0  S1  S2  Channel
+    L   L   L   Y0 = S7
+    L   L   H   Y1 = S6
+    L   H   L   Y2 = S5
+    L   H   H   Y3 = S8
+    H   L   L   Y4 = S4
+    H   L   H   Y5 = S1
+    H   H   L   Y6 = S3
+    H   H   H   Y7 = S2
+
+    The channel number is the S0 S1 S2 code read as a binary number
+*/
+constexpr uint8_t MPLX_CHANNEL_SENSOR[8] = {6, 5, 4, 7, 3, 0, 2, 1};
+
+// Returns the multiplexer channel that selects a sensor
+constexpr uint8_t mplxChannelOf(uint8_t sensorIndex, uint8_t channel = 0) {
+    return channel >= 8 ? 0
+                        : (MPLX_CHANNEL_SENSOR[channel] == sensorIndex
+                               ? channel
+                               : mplxChannelOf(sensorIndex, channel + 1));
+}
+
+// Sensor read at a given step of a Gray code scan, only one select line toggles per step
+constexpr uint8_t mplxGraySensorAt(uint8_t step) {
+    return MPLX_CHANNEL_SENSOR[step ^ (step >> 1)];
+}
+
+constexpr uint8_t MPLX_SENSOR_CHANNEL[N_OF_SENSORS] = {
+    mplxChannelOf(0), mplxChannelOf(1), mplxChannelOf(2), mplxChannelOf(3),
+    mplxChannelOf(4), mplxChannelOf(5), mplxChannelOf(6), mplxChannelOf(7)};
+
+constexpr uint8_t MPLX_GRAY_SCAN_ORDER[N_OF_SENSORS] = {
+    mplxGraySensorAt(0), mplxGraySensorAt(1), mplxGraySensorAt(2), mplxGraySensorAt(3),
+    mplxGraySensorAt(4), mplxGraySensorAt(5), mplxGraySensorAt(6), mplxGraySensorAt(7)};
 
 class SensorArray {
    public:
@@ -38,24 +79,86 @@ class SensorArray {
         LineColor colorOfTheLine,
         bool useAnalogSensors);
 
+    /*
+        Sets up the pins, when reading analog sensors also starts the
+        background sampler
+    */
     void initialize();
 
-    void updateSensorsArray();
+    /*
+        Updates every reading
+
+        With analog sensors this only copies the latest complete frame
+        from the background sampler, it never waits for a conversion. The
+        sampler is only a bit faster than the control loop, see
+        ANALOG_OVERSAMPLING, so now and then a tick gets the frame of the
+        last one again, with the same frameSequence.
+        If the sampler failed to start the sensors are read in place and
+        stamped with tickTime (us)
+    */
+    void updateSensorsArray(int64_t tickTime);
+
+    // Widens the calibrated min/max with a new reading stamped with tickTime (us)
+    void calibrateSensors(int64_t tickTime);
+
+    // Forgets the calibrated min/max, call before a new calibration sweep
+    void resetCalibration();
+
+    /*
+        Follows slow lighting changes while running, O(1) per sensor.
+
+        Each analog reading updates the average dark or light level of its
+        sensor, whichever side of the threshold it falls on, and the
+        threshold moves halfway between them. Sensors whose contrast
+        collapses keep their last threshold and are set in lowContrastMask.
 
-    void calibrateSensors();
+        Does nothing for digital sensors, their threshold is in hardware
+    */
+    void adaptCalibration();
+
+    void getCalibration(uint16_t minReads[N_OF_SENSORS], uint16_t maxReads[N_OF_SENSORS], uint16_t thresholds[N_OF_SENSORS]);
+    void setCalibration(const uint16_t minReads[N_OF_SENSORS], const uint16_t maxReads[N_OF_SENSORS], const uint16_t thresholds[N_OF_SENSORS]);
+
+    /*
+        Calculates the line position as a weighted centroid of the analog
+        readings, normalized by the calibrated min/max of each sensor.
+
+        Only the group of sensors around the strongest one is used, the
+        position goes from 0 (first sensor) to N_OF_SENSORS - 1.
+
+        Returns FALSE if the line is not seen, position is left untouched
+    */
+    bool calculateCentroid(float& position);
 
     void printAllRaw();
     void printAllProcessed();
 
+#ifdef SENSOR_SCAN_BENCHMARK
+    // Prints the cost of addressing and reading every sensor
+    void benchmarkScan(uint16_t iterations);
+#endif
+
     /*
         Returns the analog read of a sensor, receives an index;
 
         DOES NOT CHECK FOR THE LED
+
+        Must not be used while the background sampler is running
     */
     uint16_t readSensorAt(uint8_t sensorIndex);
 
     uint16_t sensorRaw[N_OF_SENSORS];
-    bool sensorProcessed[N_OF_SENSORS];
+    // Bit i is set if sensor i sees the line, see SENSOR_PATTERNS
+    uint8_t processedMask = 0;
+
+    // Bit i is set if sensor i has less than SENSOR_MIN_CONTRAST, see adaptCalibration
+    uint8_t lowContrastMask = 0;
+
+    // Sequence number of the sampler frame in sensorRaw, 0 if there is none yet
+    uint32_t frameSequence = 0;
+
+    // esp_timer time (us) at which that frame was completed
+    int64_t frameTimestamp = 0;
 
     uint16_t leftSensRaw;
     bool rightSensRaw = false;
@@ -67,11 +170,52 @@ class SensorArray {
     LineColor lineColor = WHITE;
 
    private:
-    // Turns the multiplexer pins to select a pin, receives an index
+    /*
+        Turns the multiplexer pins to select a pin, receives an index
+
+        Only the select lines that change are written, straight to the
+        GPIO set/clear registers, so the select pins must be below 32
+    */
     void selectSensor(uint8_t sensorIndex);
 
+#ifdef SENSOR_SCAN_BENCHMARK
+    // Previous implementation, three digitalWrite calls per channel
+    void selectSensorDigitalWrite(uint8_t sensorIndex);
+#endif
+
     void processReadings();
 
+    // One complete, oversampled scan of the array
+    struct SensorFrame {
+        uint16_t raw[N_OF_SENSORS];
+        uint32_t sequence;
+        int64_t timestamp;
+    };
+
+    // Starts the ADC continuous mode driver and the sampler task
+    bool startAnalogSampler();
+
+    static void analogSamplerEntry(void* arg);
+    void analogSamplerLoop();
+
+    // Discards every conversion started before the last channel switch
+    void flushConversions();
+
+    // Blocks until ANALOG_OVERSAMPLING conversions are read and returns their average
+    uint16_t readConversionFrame();
+
+    void selectLedBank(uint8_t sensorIndex);
+
+    // Copies the latest frame published by the sampler into sensorRaw
+    void copyLatestFrame();
+
+    SeqLock<SensorFrame> _latestFrame;
+    uint32_t _samplerSequence = 0;
+    uint8_t _adcChannel;
+
+    // Without the sampler the analog sensors are read one by one with analogRead
+    bool isSamplerRunning = false;
+
     uint8_t _mplxIOPin;
     uint8_t _mplxS0Pin;
     uint8_t _mplxS1Pin;
@@ -81,6 +225,12 @@ class SensorArray {
     uint8_t _leftHelperPin;
     uint8_t _rightHelperPin;
 
+    // GPIO register mask of the select pins that are HIGH for each channel
+    uint32_t _mplxChannelMask[8];
+
+    // Select pins currently HIGH
+    uint32_t _mplxCurrentMask = 0;
+
     // Minimum analog read for each sensor
     uint16_t minRead[N_OF_SENSORS];
 
@@ -89,6 +239,13 @@ class SensorArray {
 
     // Threshold for each sensor
     uint16_t sensorsThreshold[N_OF_SENSORS];
+
+    // Average dark and light readings of each sensor (Q8), see adaptCalibration
+    int32_t darkLevel[N_OF_SENSORS];
+    int32_t lightLevel[N_OF_SENSORS];
+
+    // The levels start from the calibrated min/max on the first adaptCalibration
+    bool isAdaptationSeeded = false;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SENSOR_PATTERNS_H
+#define SENSOR_PATTERNS_H
+
+#include <stdint.h>
+
+#include <array>
+
+#include "GlobalConsts.h"
+
+static_assert(N_OF_SENSORS == 8, "Sensor patterns are indexed by an 8 bit mask");
+
+// Active sensors that mean the robot is over a crossing
+#define SENSOR_CROSSING_MIN_ACTIVE 6
+
+/*
+    Everything the control tick needs from the processed sensors, looked
+    up from a mask where bit i is sensor i seeing the line
+*/
+struct SensorPattern {
+    // Mask with every sensor outside the line segment dropped
+    uint8_t filtered;
+
+    // Sensors left in filtered
+    uint8_t activeSensors;
+
+    // First and last sensor of filtered, only valid if activeSensors > 0
+    uint8_t segmentStart;
+    uint8_t segmentEnd;
+
+    bool isCrossing;
+
+    // Mean index of the sensors in filtered, only valid if activeSensors > 0
+    float position;
+};
+
+/*
+    Keeps the sensors between the last rising and the last falling edge
+    of the mask, like the per-sensor loop SensorArray used to run. Only
+    one contiguous segment, or nothing, is left.
+*/
+constexpr uint8_t filterSensorMask(uint8_t mask) {
+    uint8_t lineStartsAt = 0;
+    uint8_t lineEndsAt = N_OF_SENSORS - 1;
+    bool wasActive = false;
+
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        const bool isActive = mask & (1 << i);
+        if (i > 0 && isActive && !wasActive) lineStartsAt = i;
+        if (!isActive && wasActive) lineEndsAt = i;
+        wasActive = isActive;
+    }
+
+    uint8_t filtered = 0;
+    for (uint8_t i = lineStartsAt; i <= lineEndsAt && i < N_OF_SENSORS; i++) {
+        filtered |= mask & (1 << i);
+    }
+    return filtered;
+}
+
+constexpr SensorPattern makeSensorPattern(uint8_t mask) {
+    SensorPattern pattern{};
+    pattern.filtered = filterSensorMask(mask);
+
+    uint8_t total = 0;
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        if (!(pattern.filtered & (1 << i))) continue;
+        if (pattern.activeSensors == 0) pattern.segmentStart = i;
+        pattern.segmentEnd = i;
+        pattern.activeSensors++;
+        total += i;
+    }
+
+    pattern.isCrossing = pattern.activeSensors >= SENSOR_CROSSING_MIN_ACTIVE;
+    pattern.position = pattern.activeSensors > 0 ? float(total) / float(pattern.activeSensors) : 0;
+    return pattern;
+}
+
+constexpr std::array<SensorPattern, 256> makeSensorPatterns() {
+    std::array<SensorPattern, 256> patterns{};
+    for (uint16_t mask = 0; mask < 256; mask++) {
+        patterns[mask] = makeSensorPattern(mask);
+    }
+    return patterns;
+}
+
+/*
+    Indexed by the unfiltered mask, every field but filtered describes the
+    filtered mask. Filtering twice changes nothing, so indexing by the
+    filtered mask gives the same entry.
+
+    src/SensorPatterns.cpp checks every entry against the original loops.
+*/
+inline constexpr std::array<SensorPattern, 256> SENSOR_PATTERNS = makeSensorPatterns();
+
+#endif  // SENSOR_PATTERNS_H
@@ -0,0 +1,57 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <atomic>
+#include <stdint.h>
+
+/*
+    Shares a small value from one writer to any number of readers.
+
+    Neither side ever blocks, a reader that overlaps a write simply reads
+    again. Meant for values that are written much less often than the
+    time it takes to copy them.
+*/
+template <typename T>
+class SeqLock {
+   public:
+    void write(const T& value) {
+        const uint32_t version = _version.load(std::memory_order_relaxed);
+        _version.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _value = value;
+        _version.store(version + 2, std::memory_order_release);
+    }
+
+    T read() const {
+        for (;;) {
+            const uint32_t versionBefore = _version.load(std::memory_order_acquire);
+            if (versionBefore & 1) continue;
+
+            const T value = _value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_version.load(std::memory_order_relaxed) == versionBefore) return value;
+        }
+    }
+
+   private:
+    T _value{};
+
+    // Odd while a write is in progress
+    std::atomic<uint32_t> _version{0};
+};
+
+#endif  // SEQ_LOCK_H
@@ -0,0 +1,71 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLIP_DETECTOR_H
+#define SLIP_DETECTOR_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "GlobalConsts.h"
+
+/*
+    Detects wheel slip from the yaw rate the motor outputs should produce.
+
+    The rate expected from the difference between the right and left
+    outputs is a first order lag, SLIP_YAW_GAIN at steady state with
+    SLIP_TIME_CONSTANT_S. When the gyro disagrees with it by more than
+    the allowed residual for SLIP_CONFIRM_TICKS a wheel lost traction,
+    grip is back once the residual falls under half of it.
+
+    Both constants can be fitted from a run record, see
+    tools/decode_run.py --fit-slip
+*/
+class SlipDetector {
+   public:
+    SlipDetector();
+
+    // Forgets the expected rate and the slip events
+    void reset();
+
+    /*
+        Called once per control tick, outputDifference is right minus left
+        output applied since the last call and measuredRotSpeed the gyro
+        rotationSpeed. Returns TRUE while slipping
+    */
+    bool update(float outputDifference, float measuredRotSpeed);
+
+    bool getIsSlipping();
+
+    // Expected minus measured rotationSpeed
+    float getResidual();
+
+    // Times traction was lost since the last reset, may be read from any task
+    uint32_t getSlipEvents();
+
+   private:
+    float expectedRotSpeed = 0;
+    float residual = 0;
+
+    // Fraction of the way to the steady state rate covered in a tick
+    float alpha;
+
+    uint8_t ticksOverThreshold = 0;
+    bool isSlipping = false;
+
+    std::atomic<uint32_t> slipEvents{0};
+};
+
+#endif  // SLIP_DETECTOR_H
@@ -0,0 +1,63 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+/*
+    Lock-free single-producer/single-consumer queue.
+
+    push() may only be called from one context and pop() from one other
+    context, neither of them ever blocks. Holds up to Size - 1 elements.
+*/
+template <typename T, size_t Size>
+class SpscQueue {
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "Size must be a power of two");
+
+   public:
+    // Returns FALSE if the queue is full
+    bool push(const T& item) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        const size_t nextHead = (head + 1) & (Size - 1);
+        if (nextHead == _tail.load(std::memory_order_acquire)) return false;
+
+        _buffer[head] = item;
+        _head.store(nextHead, std::memory_order_release);
+        return true;
+    }
+
+    // Returns FALSE if the queue is empty
+    bool pop(T& item) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) return false;
+
+        item = _buffer[tail];
+        _tail.store((tail + 1) & (Size - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+    }
+
+   private:
+    T _buffer[Size];
+    std::atomic<size_t> _head{0};
+    std::atomic<size_t> _tail{0};
+};
+
+#endif  // SPSC_QUEUE_H
@@ -0,0 +1,295 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STEERING_H
+#define STEERING_H
+
+#include <Arduino.h>
+
+#include "FilteredPid.h"
+#include "GlobalConsts.h"
+#include "LineEstimator.h"
+#include "PIDestal.h"
+#include "ProfileStore.h"
+
+// Gyro::rotationSpeed for 1 rad/s, a quarter of the rate in degrees/sec
+#define ROT_SPEED_PER_RAD_S (RAD_TO_DEG / 4)
+
+/*
+    The steering of a control tick goes through three policies, picked at
+    compile time by the USE_ flags in GlobalConsts.h:
+
+        estimator   where the line is, from the sensor bar and the gyro
+        controller  how hard to turn towards it
+        mixer       how the turn and the forward output become the two
+                    motor outputs
+
+    Every call is resolved by the compiler, there is no virtual dispatch
+    in the tick. Any estimator, controller and mixer with the same
+    methods as the ones below can be combined with Steering.
+*/
+
+// What the steering sees each tick
+struct SteeringInput {
+    // sensorTarget - sensorInput, in sensor pitches, holds the last value while the line is lost
+    float lineError;
+    bool seesLine;
+
+    // Gyro::rotationSpeed and Gyro::angularVelocity
+    float rotSpeed;
+    float angularVelocity;
+
+    // Forward speed from the outputs applied since the last tick (m/s)
+    float speed;
+
+    // Since the last tick (s)
+    float dt;
+};
+
+struct LineEstimate {
+    // Same units and sign as SteeringInput::lineError
+    float error;
+
+    // Line direction relative to the robot (rad), positive to the left, 0 if not estimated
+    float heading;
+
+    // FALSE while the estimate only holds the last seen position
+    bool isValid;
+};
+
+struct SteeringOutput {
+    // Added to the right output and taken from the left one, positive turns left
+    float steering = 0;
+
+    // Intermediate results, for the run record and the telemetry
+    float sensorPidResult = 0;
+    float gyroPidResult = 0;
+    float rotSpeedTarget = 0;
+
+    // The gyro loop set the steering
+    bool isGyroSteering = false;
+
+    // The last mix could not apply the whole steering, a motor hit the clamp
+    bool isSaturated = false;
+};
+
+// The error multiplied by the shape gain of its range, see SpeedProfile
+float shapeLineError(float error, const SpeedProfile& profile);
+
+// Estimators
+
+// The sensor bar alone, the line is lost with it
+class BarEstimator {
+   public:
+    static constexpr bool hasHeading = false;
+
+    void reset() {}
+
+    LineEstimate update(const SteeringInput& input) {
+        return LineEstimate{input.lineError, 0, input.seesLine};
+    }
+};
+
+// LineEstimator, keeps following the last curve while the line is lost
+class KalmanEstimator {
+   public:
+    static constexpr bool hasHeading = true;
+
+    void reset();
+
+    LineEstimate update(const SteeringInput& input);
+
+   private:
+    LineEstimator lineEstimator;
+};
+
+// Controllers
+
+/*
+    The sensor PID follows the line, once it is lost the gyro PID holds a
+    rotation proportional to the last error
+*/
+class CascadedPidController {
+   public:
+    static constexpr bool needsHeading = false;
+
+    CascadedPidController(PIDestal& sensorPidRef, PIDestal& gyroPidRef);
+
+    // Takes the PID gains, the error shaping and the gyro weight of the profile
+    void applyProfile(const SpeedProfile& profile);
+
+    // PIDestal keeps its state between runs
+    void reset() {}
+
+    void update(const LineEstimate& estimate, const SteeringInput& input, SteeringOutput& output);
+
+   private:
+    PIDestal* sensorPid;
+    PIDestal* gyroPid;
+    SpeedProfile profile = DEFAULT_PROFILES[0];
+};
+
+/*
+    Turns along the arc through the line under the sensor bar, which is
+    SENSOR_BAR_DISTANCE_M ahead of the wheels. The rotation of that arc
+    at the current speed is fed forward and the gyro PID corrects it.
+
+    Only the gyro gains and errorGain of the profile are used
+*/
+class PurePursuitController {
+   public:
+    static constexpr bool needsHeading = false;
+
+    PurePursuitController(PIDestal& sensorPidRef, PIDestal& gyroPidRef);
+
+    void applyProfile(const SpeedProfile& profile);
+
+    void reset() {}
+
+    void update(const LineEstimate& estimate, const SteeringInput& input, SteeringOutput& output);
+
+   private:
+    PIDestal* gyroPid;
+    float errorGain = DEFAULT_PROFILES[0].errorGain;
+};
+
+/*
+    Feeds back the estimated offset and heading of the line, the heading
+    stands in for the derivative of the error without its noise.
+
+    Uses the sensor gains of the profile with the scale of the sensor
+    PID, Kp weights the shaped offset and Kd the offset rate over a tick,
+    so a profile tuned for CascadedPidController is a fair start
+*/
+class StateFeedbackController {
+   public:
+    static constexpr bool needsHeading = true;
+
+    StateFeedbackController(PIDestal& sensorPidRef, PIDestal& gyroPidRef) {}
+
+    void applyProfile(const SpeedProfile& profile);
+
+    void reset() {}
+
+    void update(const LineEstimate& estimate, const SteeringInput& input, SteeringOutput& output);
+
+   private:
+    SpeedProfile profile = DEFAULT_PROFILES[0];
+};
+
+/*
+    The same cascade as CascadedPidController with FilteredPid instead of
+    PIDestal, over the measured tick time. The gains come from the
+    profile, the PIDestal instances are left alone
+*/
+class FilteredPidController {
+   public:
+    static constexpr bool needsHeading = false;
+
+    FilteredPidController(PIDestal& sensorPidRef, PIDestal& gyroPidRef) {}
+
+    void applyProfile(const SpeedProfile& profile);
+
+    void reset();
+
+    void update(const LineEstimate& estimate, const SteeringInput& input, SteeringOutput& output);
+
+   private:
+    FilteredPid sensorPid;
+    FilteredPid gyroPid;
+    SpeedProfile profile = DEFAULT_PROFILES[0];
+};
+
+// Mixers, return TRUE if a motor output was clamped
+
+// Forward output plus and minus the steering, each side clamped on its own
+class ClampingMixer {
+   public:
+    static bool mix(float forwardOutput, float steering, float clamp, float& leftOutput, float& rightOutput);
+};
+
+// Lowers the forward output when a side would saturate, so the whole steering difference is kept
+class SteeringFirstMixer {
+   public:
+    static bool mix(float forwardOutput, float steering, float clamp, float& leftOutput, float& rightOutput);
+};
+
+template <typename Estimator, typename Controller, typename Mixer>
+class Steering {
+    static_assert(!Controller::needsHeading || Estimator::hasHeading, "The controller needs an estimator with a heading");
+
+   public:
+    Steering(PIDestal& sensorPid, PIDestal& gyroPid) : controller(sensorPid, gyroPid) {}
+
+    void applyProfile(const SpeedProfile& profile) {
+        controller.applyProfile(profile);
+    }
+
+    // Forgets the line estimate and the controller state, called when a run starts
+    void reset() {
+        estimator.reset();
+        controller.reset();
+        output.isSaturated = false;
+    }
+
+    // Works out the steering of this tick into output
+    void update(const SteeringInput& input) {
+        controller.update(estimator.update(input), input, output);
+    }
+
+    // Motor outputs for the forward output and the last steering
+    void mix(float forwardOutput, float clamp, float& leftOutput, float& rightOutput) {
+        output.isSaturated = Mixer::mix(forwardOutput, output.steering, clamp, leftOutput, rightOutput);
+    }
+
+    SteeringOutput output;
+
+   private:
+    Estimator estimator;
+    Controller controller;
+};
+
+#ifdef USE_LINE_ESTIMATOR
+typedef KalmanEstimator SelectedEstimator;
+#else
+typedef BarEstimator SelectedEstimator;
+#endif
+
+#if defined(USE_PURE_PURSUIT)
+typedef PurePursuitController SelectedController;
+#elif defined(USE_STATE_FEEDBACK)
+typedef StateFeedbackController SelectedController;
+#elif defined(USE_FILTERED_PID)
+typedef FilteredPidController SelectedController;
+#else
+typedef CascadedPidController SelectedController;
+#endif
+
+#ifdef USE_STEERING_FIRST_MIXER
+typedef SteeringFirstMixer SelectedMixer;
+#else
+typedef ClampingMixer SelectedMixer;
+#endif
+
+// The steering LineFollower is built with
+typedef Steering<SelectedEstimator, SelectedController, SelectedMixer> LineFollowerSteering;
+
+/*
+    Prints the cycles a tick of steering takes with each combination of
+    policies, over a sweep of the line across the bar that loses it now
+    and then
+*/
+void benchmarkSteering(uint16_t iterations);
+
+#endif  // STEERING_H
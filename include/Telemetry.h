@@ -0,0 +1,132 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "GlobalConsts.h"
+#include "SpscQueue.h"
+
+#define TELEMETRY_PACKET_VERSION 1
+#define TELEMETRY_N_OF_CHANNELS 6
+
+// Version, sequence and sample count
+#define TELEMETRY_HEADER_SIZE 4
+
+// Largest packet, an ATT notification carries MTU - 3 bytes
+#define TELEMETRY_MAX_PACKET_SIZE (TELEMETRY_MTU - 3)
+
+/*
+    sensorInput, rotSpeed, sensorPidResult, gyroPidResult, leftMotorOutput
+    and rightMotorOutput are sent as int16, multiplied by these scales
+*/
+constexpr float TELEMETRY_CHANNEL_SCALE[TELEMETRY_N_OF_CHANNELS] = {1000, 100, 100, 100, 10000, 10000};
+
+// One control tick, quantized
+struct TelemetrySample {
+    // Clock time (us) at the start of the tick, esp_timer on the robot, low 32 bits
+    uint32_t timestamp;
+    int16_t channels[TELEMETRY_N_OF_CHANNELS];
+};
+
+// Rounds a value to its channel scale, saturating at the int16 range
+int16_t quantizeTelemetry(float value, uint8_t channel);
+
+/*
+    Packs samples into a packet
+
+        version     uint8   TELEMETRY_PACKET_VERSION
+        sequence    uint16  Incremented on every packet
+        count       uint8   Number of samples
+        timestamp   uint32  First sample
+        channels    int16   First sample, TELEMETRY_N_OF_CHANNELS of them
+
+    Every other sample is written as the difference to the one before it,
+    the timestamp as a varint and each channel as a zigzag varint.
+    All values are little endian. A packet never depends on the previous
+    one, a lost notification only loses its own samples.
+*/
+class TelemetryEncoder {
+   public:
+    // Starts an empty packet in buffer, capacity must be at least TELEMETRY_HEADER_SIZE + 16
+    void begin(uint8_t* buffer, uint16_t capacity, uint16_t sequence);
+
+    // Returns FALSE if the sample does not fit, the packet is left as it was
+    bool add(const TelemetrySample& sample);
+
+    // Writes the sample count and returns the packet size
+    uint16_t finish();
+
+    uint8_t getCount();
+
+    // Timestamp of the first sample, only valid if getCount() > 0
+    uint32_t getFirstTimestamp();
+
+   private:
+    static uint8_t writeVarint(uint8_t* output, uint32_t value);
+
+    uint8_t* buffer = NULL;
+    uint16_t capacity = 0;
+    uint16_t size = 0;
+    uint8_t count = 0;
+
+    TelemetrySample firstSample;
+    TelemetrySample lastSample;
+};
+
+/*
+    Hands the samples of the control task over to a transport.
+
+    The control task only pushes into a lock-free queue, the packets are
+    built by the task that sends them, so a slow or absent link never
+    reaches the control loop. Samples that do not fit the queue are
+    dropped and counted.
+*/
+class TelemetryStream {
+   public:
+    // Queues a sample, may only be called by the control task, never blocks
+    void push(const TelemetrySample& sample);
+
+    /*
+        Packs the queued samples into buffer, at most capacity bytes.
+
+        Returns the size of the packet once it is full or its first
+        sample is TELEMETRY_MAX_LATENCY_MS old, else 0 and the samples
+        wait for the next call. timeNow is the Clock time (us) of the
+        call, low 32 bits.
+        May only be called by one task
+    */
+    uint16_t readPacket(uint8_t* buffer, uint16_t capacity, uint32_t timeNow);
+
+    uint32_t getDroppedSamples();
+
+   private:
+    SpscQueue<TelemetrySample, TELEMETRY_QUEUE_SIZE> samples;
+    std::atomic<uint32_t> droppedSamples{0};
+
+    TelemetryEncoder encoder;
+    uint8_t packet[TELEMETRY_MAX_PACKET_SIZE];
+    uint16_t packetCapacity = 0;
+    uint16_t packetSequence = 0;
+
+    // Popped but did not fit the last packet
+    TelemetrySample pendingSample;
+    bool hasPendingSample = false;
+};
+
+#endif  // TELEMETRY_H
@@ -0,0 +1,76 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TELEMETRY_BLE_H
+#define TELEMETRY_BLE_H
+
+#include "GlobalConsts.h"
+
+#ifdef USE_BLUETOOTH
+
+#include <ArduinoBLE.h>
+
+#include "Telemetry.h"
+
+#define TELEMETRY_SERVICE_UUID "6b1c0001-52a4-4b5e-9a7e-3f0d2c8e7a10"
+#define TELEMETRY_CHARACTERISTIC_UUID "6b1c0002-52a4-4b5e-9a7e-3f0d2c8e7a10"
+
+// Connection handles searched for the central, the controller hands out the lowest ones first
+#define TELEMETRY_MAX_CONNECTION_HANDLE 16
+
+// Sends a TelemetryStream as notifications of its own characteristic
+class TelemetryBle {
+   public:
+    TelemetryBle();
+
+    /*
+        Adds the telemetry service to the ArduinoBLE device started by
+        PIDestalRemoteBLE. Advertising is stopped while the service is
+        added and started again with it.
+
+        Returns FALSE if advertising could not be restarted
+    */
+    bool initialize();
+
+    /*
+        Sends up to TELEMETRY_MAX_PACKETS_PER_TICK packets sized to the
+        MTU of the central, called by the housekeeping task. The first
+        call after a central connects asks it for a larger MTU and waits
+        for the answer. Without a
+        subscribed central the stream is drained and discarded.
+        timeNow is the Clock time (us) of the call, low 32 bits
+    */
+    void process(TelemetryStream& stream, uint32_t timeNow);
+
+   private:
+    /*
+        ATT MTU of the connected central, 23 until the exchange started by
+        the first call of a connection, or one started by the central,
+        agrees on more
+    */
+    uint16_t getPeerMtu();
+
+    BLEService service;
+    BLECharacteristic characteristic;
+    bool isInitialized = false;
+
+    // ArduinoBLE keeps the handle of a connection private, it is found through ATT
+    uint16_t connectionHandle = 0;
+    bool isMtuExchanged = false;
+
+    uint8_t packet[TELEMETRY_MAX_PACKET_SIZE];
+};
+
+#endif  // USE_BLUETOOTH
+#endif  // TELEMETRY_BLE_H
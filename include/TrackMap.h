@@ -0,0 +1,88 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TRACK_MAP_H
+#define TRACK_MAP_H
+
+#include <Arduino.h>
+
+#include "GlobalConsts.h"
+
+struct TrackSegment {
+    // Heading change over the segment divided by its length (rad/m)
+    float curvature;
+
+    // Planned speed at the start of the segment (m/s)
+    float speed;
+};
+
+/*
+    Curvature map of one lap, split in segments of TRACK_MAP_SEGMENT_LENGTH_M.
+
+    The map is recorded during a first lap, then plan() turns it into a
+    speed profile that respects the lateral, braking and acceleration limits.
+*/
+class TrackMap {
+   public:
+    enum State {
+        EMPTY,
+        RECORDING,
+        READY
+    };
+
+    // Allocates the segments in PSRAM, returns FALSE on failure
+    bool initialize();
+
+    // Discards the current map and starts a new one
+    void startRecording();
+
+    /*
+        Adds the movement of one tick to the map
+
+        distance in meters and headingChange in radians
+    */
+    void record(float distance, float headingChange);
+
+    /*
+        Closes the recording and computes the speed profile, the segments
+        recorded past lapLength (m) are dropped
+
+        Returns FALSE if the lap was too short or overflowed the map
+    */
+    bool finishRecording(float lapLength);
+
+    // Returns the planned speed (m/s) at a distance from the start line
+    float getSpeedAt(float distance);
+
+    void clear();
+
+    State getState();
+
+    uint16_t getNumberOfSegments();
+
+   private:
+    void plan();
+
+    TrackSegment* segments = NULL;
+    uint16_t numberOfSegments = 0;
+    bool hasOverflowed = false;
+
+    State state = EMPTY;
+
+    // Accumulated on the segment being recorded
+    float segmentDistance = 0;
+    float segmentHeadingChange = 0;
+};
+
+#endif  // TRACK_MAP_H
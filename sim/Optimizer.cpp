@@ -0,0 +1,163 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Optimizer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+
+#include "WorkStealingPool.h"
+
+namespace {
+
+void evaluate(const OptimizerConfig& config, OptimizerCandidate& candidate) {
+    SimulationConfig simulation = config.simulation;
+    simulation.profile = &candidate.profile;
+    simulation.dumpPath = NULL;
+    simulation.telemetryPath = NULL;
+    simulation.tracePath = NULL;
+    simulation.verbose = false;
+
+    float totalScore = 0;
+    float totalLapTime = 0;
+    for (uint32_t run = 1; run <= config.runsPerCandidate; run++) {
+        randomizeStart(simulation, run);
+        const SimulationResult result = simulate(simulation);
+
+        const bool isFinished = result.finished && result.lapTime >= 0;
+        if (isFinished) {
+            candidate.finishedRuns++;
+            totalLapTime += result.lapTime;
+        }
+        candidate.maxDeviation = fmaxf(candidate.maxDeviation, result.maxDeviation);
+        totalScore += (isFinished ? result.lapTime : simulation.timeLimit) +
+                      result.maxDeviation * 1000 * SIM_OPT_DEVIATION_PENALTY_S_PER_MM;
+    }
+    candidate.score = totalScore / config.runsPerCandidate;
+    if (candidate.finishedRuns > 0) candidate.meanLapTime = totalLapTime / candidate.finishedRuns;
+}
+
+OptimizerCandidate makeCandidate(const OptimizerConfig& config, const SpeedProfile& baseProfile, const std::vector<float>& values) {
+    OptimizerCandidate candidate;
+    candidate.profile = baseProfile;
+    candidate.values = values;
+    for (size_t i = 0; i < values.size(); i++) {
+        float* field = ProfileStore::findField(candidate.profile, config.parameters[i].name.c_str());
+        if (field != NULL) *field = values[i];
+    }
+    return candidate;
+}
+
+bool isBetter(const OptimizerCandidate& a, const OptimizerCandidate& b) {
+    return a.score < b.score;
+}
+
+}  // namespace
+
+std::vector<OptimizerParameter> defaultOptimizerParameters(const SpeedProfile& profile) {
+    // Gains from off to twice the current value
+    auto gainRange = [](const char* name, float gain) {
+        return OptimizerParameter{name, 0, gain > 0 ? gain * 2 : 1};
+    };
+    return {
+        gainRange("sensorKp", profile.sensorGains[0]),
+        gainRange("sensorKd", profile.sensorGains[2]),
+        gainRange("gyroKp", profile.gyroGains[0]),
+        gainRange("gyroKd", profile.gyroGains[2]),
+        {"minOffset", 0.2f, 1.0f},
+        {"maxOffset", 0.2f, 1.0f},
+        {"turbo", 1.0f, 2.0f},
+        {"turboError", 0.0f, 3.0f}};
+}
+
+std::vector<OptimizerCandidate> optimize(const OptimizerConfig& config) {
+    const SpeedProfile baseProfile = simulationProfile(config.simulation);
+    const size_t numberOfParameters = config.parameters.size();
+    const uint32_t populationSize = std::max(config.populationSize, 2U);
+    const uint32_t eliteCount = std::max(uint32_t(populationSize * SIM_OPT_ELITE_FRACTION + 0.5f), 1U);
+
+    // Sampling distribution, starts at the current profile and spans the ranges
+    std::vector<float> mean(numberOfParameters);
+    std::vector<float> spread(numberOfParameters);
+    for (size_t i = 0; i < numberOfParameters; i++) {
+        const OptimizerParameter& parameter = config.parameters[i];
+        SpeedProfile profile = baseProfile;
+        const float* field = ProfileStore::findField(profile, parameter.name.c_str());
+        mean[i] = constrain(field != NULL ? *field : parameter.min, parameter.min, parameter.max);
+        spread[i] = (parameter.max - parameter.min) / 4;
+    }
+
+    std::mt19937 random(config.seed);
+    std::normal_distribution<float> normal(0, 1);
+    WorkStealingPool pool(config.threads);
+    std::vector<OptimizerCandidate> candidates;
+
+    for (uint32_t generation = 0; generation < config.generations; generation++) {
+        std::vector<OptimizerCandidate> population;
+        for (uint32_t i = 0; i < populationSize; i++) {
+            std::vector<float> values(numberOfParameters);
+            for (size_t j = 0; j < numberOfParameters; j++) {
+                const OptimizerParameter& parameter = config.parameters[j];
+                // The first candidate of all is the unchanged profile, the reference for the rest
+                const float value = generation == 0 && i == 0 ? mean[j] : mean[j] + spread[j] * normal(random);
+                values[j] = constrain(value, parameter.min, parameter.max);
+            }
+            population.push_back(makeCandidate(config, baseProfile, values));
+            population.back().isReference = generation == 0 && i == 0;
+        }
+
+        for (OptimizerCandidate& candidate : population) {
+            pool.submit([&config, &candidate] { evaluate(config, candidate); });
+        }
+        pool.wait();
+
+        std::sort(population.begin(), population.end(), isBetter);
+        for (size_t j = 0; j < numberOfParameters; j++) {
+            float eliteMean = 0;
+            for (uint32_t i = 0; i < eliteCount; i++) eliteMean += population[i].values[j];
+            eliteMean /= eliteCount;
+
+            float eliteVariance = 0;
+            for (uint32_t i = 0; i < eliteCount; i++) {
+                const float difference = population[i].values[j] - eliteMean;
+                eliteVariance += difference * difference;
+            }
+            eliteVariance /= eliteCount;
+
+            const OptimizerParameter& parameter = config.parameters[j];
+            const float minSpread = (parameter.max - parameter.min) * SIM_OPT_MIN_SPREAD;
+            mean[j] = SIM_OPT_SMOOTHING * eliteMean + (1 - SIM_OPT_SMOOTHING) * mean[j];
+            spread[j] = SIM_OPT_SMOOTHING * sqrtf(eliteVariance) + (1 - SIM_OPT_SMOOTHING) * spread[j];
+            spread[j] = fmaxf(spread[j], minSpread);
+        }
+
+        candidates.insert(candidates.end(), population.begin(), population.end());
+        if (config.verbose) {
+            const OptimizerCandidate& best = *std::min_element(candidates.begin(), candidates.end(), isBetter);
+            fprintf(stderr, "generation %u: best score %.3f, lap %.3fs, max deviation %.1fmm, %u/%u runs finished\n",
+                    generation + 1,
+                    best.score,
+                    best.meanLapTime,
+                    best.maxDeviation * 1000,
+                    best.finishedRuns,
+                    config.runsPerCandidate);
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), isBetter);
+    return candidates;
+}
@@ -0,0 +1,105 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_OPTIMIZER_H
+#define SIM_OPTIMIZER_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "ProfileStore.h"
+#include "Simulation.h"
+
+// Seconds added to the score for every millimeter of the largest deviation of a run, keeps some margin to the line
+#define SIM_OPT_DEVIATION_PENALTY_S_PER_MM 0.01f
+
+// Share of the population the next generation is fitted to
+#define SIM_OPT_ELITE_FRACTION 0.25f
+
+// Weight of the elites when the sampling distribution moves, the rest keeps the old one
+#define SIM_OPT_SMOOTHING 0.7f
+
+// The spread of a parameter never shrinks under this fraction of its range
+#define SIM_OPT_MIN_SPREAD 0.01f
+
+// A field of SpeedProfile, by its ProfileStore::findField name, and the range it is searched in
+struct OptimizerParameter {
+    std::string name;
+    float min;
+    float max;
+};
+
+struct OptimizerConfig {
+    // Track, mode, noise and grip of every run, the profile is replaced by each candidate
+    SimulationConfig simulation;
+
+    // Searched fields, the rest of the profile keeps its value in simulation
+    std::vector<OptimizerParameter> parameters;
+
+    // Runs of each candidate, the first starts centered and the rest from the same randomized poses for every candidate
+    uint32_t runsPerCandidate = 3;
+
+    uint32_t generations = 15;
+    uint32_t populationSize = 32;
+
+    // 0 uses every hardware thread
+    uint32_t threads = 0;
+    uint32_t seed = 1;
+
+    // Prints the best candidate of each generation
+    bool verbose = true;
+};
+
+struct OptimizerCandidate {
+    SpeedProfile profile;
+
+    // Value of each OptimizerConfig::parameters
+    std::vector<float> values;
+
+    /*
+        Mean lap time plus the deviation penalty, lower is better. Runs
+        that do not finish count as the time limit
+    */
+    float score = 0;
+
+    // Over the finished runs (s), negative if none finished
+    float meanLapTime = -1;
+
+    // Largest of the runs (m)
+    float maxDeviation = 0;
+
+    uint32_t finishedRuns = 0;
+
+    // The unchanged profile
+    bool isReference = false;
+};
+
+// The usual tuning knobs of a mode, around the values of its profile
+std::vector<OptimizerParameter> defaultOptimizerParameters(const SpeedProfile& profile);
+
+/*
+    Searches the parameters with the cross-entropy method: each generation
+    samples a population from a normal distribution per parameter,
+    simulates every candidate in parallel and refits the distribution to
+    the best ones, so the search narrows from the whole range to the
+    neighbourhood of the best profile.
+
+    The first candidate is the unchanged profile. Returns every candidate,
+    best first
+*/
+std::vector<OptimizerCandidate> optimize(const OptimizerConfig& config);
+
+#endif  // SIM_OPTIMIZER_H
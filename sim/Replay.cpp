@@ -0,0 +1,230 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Replay.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#include "Pins.h"
+#include "SimHal.h"
+#include "Simulation.h"
+#include "Trace.h"
+
+namespace {
+
+// Answers every read with the inputs of the tick being replayed
+class ReplayBoard : public SimBoard {
+   public:
+    int readDigital(uint8_t pin) override {
+        if (pin == MIO) return _tick.sensorDigital & (1 << selectedSensor()) ? HIGH : LOW;
+        if (pin == LEFT_HELPER_SENS) return _leftHelperLevel;
+        if (pin == RIGHT_HELPER_SENS) return _rightHelperLevel;
+        return LOW;
+    }
+
+    uint16_t readAnalog(uint8_t pin) override {
+        if (pin != MIO) return SIM_ANALOG_BACKGROUND;
+        return _tick.sensorAnalog[selectedSensor()];
+    }
+
+    int16_t readGyroZ() override {
+        return _tick.gyroZ;
+    }
+
+    int16_t readAccelX() override {
+        return _tick.accelX;
+    }
+
+    void drive(float leftOutput, float rightOutput) override {
+        setMotorCommand(TRACE_MOTOR_DRIVE, leftOutput, rightOutput);
+    }
+
+    void brake() override {
+        setMotorCommand(TRACE_MOTOR_BRAKE, 0, 0);
+    }
+
+    void coast() override {
+        setMotorCommand(TRACE_MOTOR_COAST, 0, 0);
+    }
+
+    void advance(uint64_t micros) override {
+        simhal::setTime(simhal::now() + micros);
+    }
+
+    // Inputs of the next control tick, its motor command starts empty
+    void beginTick(const TraceEvent& tick) {
+        _tick = tick;
+        setMotorCommand(TRACE_MOTOR_NONE, 0, 0);
+    }
+
+    // The tick with the motor command the firmware gave instead of the recorded one
+    TraceEvent endTick() {
+        TraceEvent tick = _tick;
+        tick.motorCommand = _motorCommand;
+        tick.leftOutput = _leftOutput;
+        tick.rightOutput = _rightOutput;
+        return tick;
+    }
+
+    void setHelperLevel(uint8_t pin, uint8_t level) {
+        if (pin == LEFT_HELPER_SENS) _leftHelperLevel = level;
+        if (pin == RIGHT_HELPER_SENS) _rightHelperLevel = level;
+    }
+
+   private:
+    uint8_t selectedSensor() {
+        const uint8_t channel = simhal::outputLevel(MPLX_S0) << 2 |
+                                simhal::outputLevel(MPLX_S1) << 1 |
+                                simhal::outputLevel(MPLX_S2);
+        return MPLX_CHANNEL_SENSOR[channel];
+    }
+
+    void setMotorCommand(TraceMotorCommand command, float leftOutput, float rightOutput) {
+        _motorCommand = command;
+        _leftOutput = leftOutput;
+        _rightOutput = rightOutput;
+    }
+
+    TraceEvent _tick = {};
+    uint8_t _leftHelperLevel = LOW;
+    uint8_t _rightHelperLevel = LOW;
+
+    TraceMotorCommand _motorCommand = TRACE_MOTOR_NONE;
+    float _leftOutput = 0, _rightOutput = 0;
+};
+
+// Runs every event of the trace, returns the wall time spent (s) and the ticks with their new commands
+double replayOnce(const std::vector<TraceEvent>& events, uint8_t mode, bool verbose, std::vector<TraceEvent>& replayedTicks) {
+    ReplayBoard board;
+    simhal::attach(&board);
+    simhal::setSerialEnabled(verbose);
+    replayedTicks.clear();
+
+    // Same profile as a simulation with the default config
+    SimulationConfig defaults;
+    defaults.mode = LineFollower::Modes(mode);
+    double wallTime;
+    {
+        SimFirmware firmware(defaults.mode, simulationProfile(defaults));
+        LineFollower& lineFollower = firmware.lineFollower;
+
+        const auto wallStart = std::chrono::steady_clock::now();
+        for (const TraceEvent& event : events) {
+            // A delay() in the firmware may have gone past the event
+            if (event.time > simhal::now()) simhal::setTime(event.time);
+
+            switch (event.type) {
+                case TRACE_CONTROL_TICK:
+                    board.beginTick(event);
+                    lineFollower.run();
+                    replayedTicks.push_back(board.endTick());
+                    break;
+                case TRACE_HOUSEKEEPING_TICK:
+                    lineFollower.runHousekeeping();
+                    break;
+                case TRACE_START:
+                    lineFollower.toggleMotorsAreActive();
+                    break;
+                case TRACE_HELPER_EDGE:
+                    board.setHelperLevel(event.pin, event.level);
+                    simhal::updateInput(event.pin, event.level);
+                    break;
+            }
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - wallStart;
+        wallTime = elapsed.count();
+    }
+
+    simhal::detach();
+    return wallTime;
+}
+
+void selectTicks(const std::vector<TraceEvent>& events, std::vector<TraceEvent>& ticks) {
+    ticks.clear();
+    for (const TraceEvent& event : events) {
+        if (event.type == TRACE_CONTROL_TICK) ticks.push_back(event);
+    }
+}
+
+}  // namespace
+
+ReplayResult replay(const ReplayConfig& config) {
+    ReplayResult result;
+
+    uint8_t mode;
+    std::vector<TraceEvent> events;
+    if (!readTrace(config.tracePath, mode, events)) return result;
+
+    std::vector<TraceEvent> goldenTicks;
+    if (config.goldenPath != NULL) {
+        uint8_t goldenMode;
+        std::vector<TraceEvent> goldenEvents;
+        if (!readTrace(config.goldenPath, goldenMode, goldenEvents)) return result;
+        selectTicks(goldenEvents, goldenTicks);
+    } else {
+        selectTicks(events, goldenTicks);
+    }
+
+    const uint32_t repeat = config.repeat > 0 ? config.repeat : 1;
+    std::vector<TraceEvent> replayedTicks;
+    double wallTime = 0;
+    for (uint32_t i = 0; i < repeat; i++) {
+        wallTime += replayOnce(events, mode, config.verbose, replayedTicks);
+    }
+
+    result.ticks = replayedTicks.size();
+    if (goldenTicks.size() != replayedTicks.size()) {
+        fprintf(stderr, "The golden trace has %zu ticks, the replayed one %zu\n", goldenTicks.size(), replayedTicks.size());
+        return result;
+    }
+    result.isValid = true;
+
+    double squaredErrorSum = 0;
+    for (uint32_t i = 0; i < result.ticks; i++) {
+        const TraceEvent& golden = goldenTicks[i];
+        const TraceEvent& replayed = replayedTicks[i];
+        const float leftError = fabsf(replayed.leftOutput - golden.leftOutput);
+        const float rightError = fabsf(replayed.rightOutput - golden.rightOutput);
+        squaredErrorSum += leftError * leftError + rightError * rightError;
+        result.maxOutputError = fmaxf(result.maxOutputError, fmaxf(leftError, rightError));
+
+        const bool isMatch = replayed.motorCommand == golden.motorCommand &&
+                             leftError <= config.tolerance &&
+                             rightError <= config.tolerance;
+        if (isMatch) continue;
+        if (result.firstMismatch < 0) {
+            result.firstMismatch = i;
+            result.firstMismatchTime = golden.time / 1000000.0f;
+        }
+        result.mismatchedTicks++;
+    }
+    if (result.ticks > 0) result.rmsOutputError = sqrt(squaredErrorSum / (2.0 * result.ticks));
+
+    result.ticksPerSecond = wallTime > 0 ? double(result.ticks) * repeat / wallTime : 0;
+
+    if (config.outputPath != NULL) {
+        TraceWriter output;
+        if (output.open(config.outputPath, mode)) {
+            size_t tick = 0;
+            for (const TraceEvent& event : events) {
+                output.write(event.type == TRACE_CONTROL_TICK ? replayedTicks[tick++] : event);
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,77 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_REPLAY_H
+#define SIM_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ReplayConfig {
+    // Trace recorded by the simulation with --record, see sim/Trace.h
+    const char* tracePath = NULL;
+
+    // Trace holding the expected motor commands, the replayed one when NULL
+    const char* goldenPath = NULL;
+
+    // Writes the replayed inputs with the new motor commands here when set, a golden trace for later replays
+    const char* outputPath = NULL;
+
+    // Times the trace is replayed, for a steadier throughput figure
+    uint32_t repeat = 1;
+
+    // Largest difference between two motor outputs that still counts as a match
+    float tolerance = 0;
+
+    // Prints the firmware Serial output
+    bool verbose = false;
+};
+
+struct ReplayResult {
+    // FALSE if a trace could not be read or the golden one has another number of ticks
+    bool isValid = false;
+
+    // Control ticks in the trace
+    uint32_t ticks = 0;
+
+    // Ticks whose motor command is not the golden one
+    uint32_t mismatchedTicks = 0;
+
+    // First of them and its time (s), negative if there is none
+    int32_t firstMismatch = -1;
+    float firstMismatchTime = -1;
+
+    // Difference between the replayed and the golden motor outputs, over every tick
+    float maxOutputError = 0;
+    float rmsOutputError = 0;
+
+    // Control ticks run per second of wall time, the robot model is not in the way
+    double ticksPerSecond = 0;
+};
+
+/*
+    Feeds the inputs of a trace to a fresh LineFollower, tick by tick, and
+    compares the motor commands it gives with the golden ones.
+
+    The robot does not react to the new commands, a replay tells whether
+    and where a change to the controller alters its output on the same
+    inputs and what each tick costs. Whether the change drives better is
+    for the closed loop simulation to tell.
+
+    The gains are the ones the simulation would use, from GlobalConsts.h,
+    and the mode is the one of the recorded run.
+*/
+ReplayResult replay(const ReplayConfig& config);
+
+#endif  // SIM_REPLAY_H
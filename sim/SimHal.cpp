@@ -0,0 +1,316 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <Arduino.h>
+#include <MPU6050.h>
+#include <Preferences.h>
+#include <TB6612FNG.h>
+#include <Wire.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SimHal.h"
+#include "esp_rom_crc.h"
+#include "soc/gpio_struct.h"
+
+#define SIM_NUMBER_OF_PINS 64
+
+namespace {
+
+struct InterruptHandler {
+    void (*function)(void) = NULL;
+    void (*functionWithArg)(void*) = NULL;
+    void* arg = NULL;
+    int mode = 0;
+};
+
+// Everything the firmware can see is per thread, see SimBoard
+thread_local SimBoard* board = NULL;
+thread_local uint64_t simTime = 0;
+thread_local uint8_t outputLevels[SIM_NUMBER_OF_PINS];
+thread_local uint8_t inputLevels[SIM_NUMBER_OF_PINS];
+thread_local InterruptHandler interruptHandlers[SIM_NUMBER_OF_PINS];
+thread_local std::map<std::string, std::vector<uint8_t>>* nvs = NULL;
+thread_local std::vector<void*>* psramBlocks = NULL;
+thread_local bool serialEnabled = false;
+
+void releaseThreadState() {
+    if (psramBlocks != NULL) {
+        for (void* block : *psramBlocks) free(block);
+        delete psramBlocks;
+        psramBlocks = NULL;
+    }
+    delete nvs;
+    nvs = NULL;
+}
+
+void setOutput(uint8_t pin, uint8_t level) {
+    if (pin < SIM_NUMBER_OF_PINS) outputLevels[pin] = level;
+}
+
+}  // namespace
+
+namespace simhal {
+
+void attach(SimBoard* simBoard) {
+    releaseThreadState();
+    board = simBoard;
+    simTime = 0;
+    memset(outputLevels, 0, sizeof(outputLevels));
+    memset(inputLevels, 0, sizeof(inputLevels));
+    for (InterruptHandler& handler : interruptHandlers) handler = InterruptHandler();
+}
+
+void detach() {
+    releaseThreadState();
+    board = NULL;
+    // The next SimRobot sets its inputs before attaching, the old ISRs must not see them
+    for (InterruptHandler& handler : interruptHandlers) handler = InterruptHandler();
+}
+
+uint64_t now() {
+    return simTime;
+}
+
+void setTime(uint64_t micros) {
+    simTime = micros;
+}
+
+uint8_t outputLevel(uint8_t pin) {
+    return pin < SIM_NUMBER_OF_PINS ? outputLevels[pin] : LOW;
+}
+
+void updateInput(uint8_t pin, uint8_t level) {
+    if (pin >= SIM_NUMBER_OF_PINS) return;
+    const uint8_t lastLevel = inputLevels[pin];
+    inputLevels[pin] = level;
+    if (level == lastLevel) return;
+
+    const InterruptHandler& handler = interruptHandlers[pin];
+    const bool isRising = level == HIGH;
+    const bool shouldRun = handler.mode == CHANGE ||
+                           (handler.mode == RISING && isRising) ||
+                           (handler.mode == FALLING && !isRising);
+    if (!shouldRun) return;
+
+    if (handler.function != NULL) handler.function();
+    if (handler.functionWithArg != NULL) handler.functionWithArg(handler.arg);
+}
+
+void setSerialEnabled(bool enabled) {
+    serialEnabled = enabled;
+}
+
+}  // namespace simhal
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    setOutput(pin, val ? HIGH : LOW);
+}
+
+int digitalRead(uint8_t pin) {
+    return board != NULL ? board->readDigital(pin) : LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+    return board != NULL ? board->readAnalog(pin) : 0;
+}
+
+int8_t digitalPinToAnalogChannel(uint8_t pin) {
+    // GPIO1 to GPIO10 are ADC1 on the ESP32-S3
+    return pin >= 1 && pin <= 10 ? pin - 1 : -1;
+}
+
+unsigned long millis() {
+    return simTime / 1000;
+}
+
+unsigned long micros() {
+    return simTime;
+}
+
+void delay(uint32_t ms) {
+    delayMicroseconds(ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+    if (board != NULL) {
+        board->advance(us);
+    } else {
+        simTime += us;
+    }
+}
+
+int64_t esp_timer_get_time() {
+    return simTime;
+}
+
+void attachInterrupt(uint8_t pin, void (*userFunc)(void), int mode) {
+    if (pin >= SIM_NUMBER_OF_PINS) return;
+    interruptHandlers[pin] = InterruptHandler();
+    interruptHandlers[pin].function = userFunc;
+    interruptHandlers[pin].mode = mode;
+}
+
+void attachInterruptArg(uint8_t pin, void (*userFunc)(void*), void* arg, int mode) {
+    if (pin >= SIM_NUMBER_OF_PINS) return;
+    interruptHandlers[pin] = InterruptHandler();
+    interruptHandlers[pin].functionWithArg = userFunc;
+    interruptHandlers[pin].arg = arg;
+    interruptHandlers[pin].mode = mode;
+}
+
+void* ps_malloc(size_t size) {
+    void* block = malloc(size);
+    if (block == NULL) return NULL;
+    // Freed with the rest of the thread state on the next attach
+    if (psramBlocks == NULL) psramBlocks = new std::vector<void*>();
+    psramBlocks->push_back(block);
+    return block;
+}
+
+const gpio_dev_t GPIO = {{true}, {false}};
+
+void SimGpioRegister::operator=(uint32_t mask) const {
+    while (mask) {
+        setOutput(__builtin_ctz(mask), setsPins ? HIGH : LOW);
+        mask &= mask - 1;
+    }
+}
+
+size_t Print::print(const char* value) {
+    return write(reinterpret_cast<const uint8_t*>(value), strlen(value));
+}
+
+size_t Print::print(char value) {
+    return write(reinterpret_cast<const uint8_t*>(&value), 1);
+}
+
+size_t Print::print(int value) {
+    return print(static_cast<long long>(value));
+}
+
+size_t Print::print(unsigned int value) {
+    return print(static_cast<unsigned long long>(value));
+}
+
+size_t Print::print(long value) {
+    return print(static_cast<long long>(value));
+}
+
+size_t Print::print(unsigned long value) {
+    return print(static_cast<unsigned long long>(value));
+}
+
+size_t Print::print(long long value) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "%lld", value);
+    return print(buffer);
+}
+
+size_t Print::print(unsigned long long value) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "%llu", value);
+    return print(buffer);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return print(buffer);
+}
+
+size_t Print::println() {
+    return print("\r\n");
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (serialEnabled) fwrite(buffer, 1, size, stderr);
+    return size;
+}
+
+HardwareSerial Serial;
+
+uint32_t EspClass::getCycleCount() {
+    const auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+EspClass ESP;
+
+TwoWire Wire;
+
+int16_t MPU6050::getRotationZ() {
+    return board != NULL ? board->readGyroZ() : 0;
+}
+
+int16_t MPU6050::getAccelerationX() {
+    return board != NULL ? board->readAccelX() : 0;
+}
+
+void Tb6612fng::drive(float outputA, float outputB) {
+    if (board != NULL) board->drive(outputA, outputB);
+}
+
+void Tb6612fng::brake() {
+    if (board != NULL) board->brake();
+}
+
+void Tb6612fng::coast() {
+    if (board != NULL) board->coast();
+}
+
+bool Preferences::begin(const char* name, bool readOnly) {
+    if (nvs == NULL) nvs = new std::map<std::string, std::vector<uint8_t>>();
+    namespaceName = name;
+    return true;
+}
+
+void Preferences::end() {}
+
+size_t Preferences::getBytesLength(const char* key) {
+    const auto entry = nvs->find(namespaceName + "/" + key);
+    return entry != nvs->end() ? entry->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t length) {
+    const auto entry = nvs->find(namespaceName + "/" + key);
+    if (entry == nvs->end() || entry->second.size() > length) return 0;
+    memcpy(buffer, entry->second.data(), entry->second.size());
+    return entry->second.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    (*nvs)[namespaceName + "/" + key] = std::vector<uint8_t>(bytes, bytes + length);
+    return length;
+}
+
+bool Preferences::remove(const char* key) {
+    return nvs->erase(namespaceName + "/" + key) > 0;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buffer, uint32_t length) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= buffer[i];
+        for (uint8_t bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
@@ -0,0 +1,614 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Simulation.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <random>
+
+#include "Pins.h"
+#include "SimHal.h"
+#include "Trace.h"
+
+// Segments searched around the last known position, about 10cm each way
+#define SIM_PROJECTION_WINDOW 10
+
+namespace {
+
+thread_local LineFollower* currentLineFollower = NULL;
+
+void leftHelperInterrupt() {
+    currentLineFollower->onHelperEdge(LineFollower::LEFT, digitalRead(LEFT_HELPER_SENS), micros());
+}
+
+void rightHelperInterrupt() {
+    currentLineFollower->onHelperEdge(LineFollower::RIGHT, digitalRead(RIGHT_HELPER_SENS), micros());
+}
+
+class FilePrint : public Print {
+   public:
+    explicit FilePrint(FILE* file) : _file(file) {}
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        return fwrite(buffer, 1, size, _file);
+    }
+
+   private:
+    FILE* _file;
+};
+
+/*
+    Differential drive robot with the sensor bar, helper sensors and gyro
+    of the real one, driven by the firmware through the HAL
+*/
+class SimRobot : public SimBoard {
+   public:
+    SimRobot(const SimulationConfig& config)
+        : _config(config),
+          _track(*config.track),
+          _random(config.seed),
+          _gyroNoise(0, config.gyroNoise > 0 ? config.gyroNoise : 1) {
+        placeAtStart();
+    }
+
+    // Puts the robot back on the start pose, standing, for another run, the clock and the trace go on
+    void placeAtStart() {
+        float lineX, lineY, lineHeading;
+        _track.getPoseAt(0, lineX, lineY, lineHeading);
+        _x = lineX - sinf(lineHeading) * _config.startLateral;
+        _y = lineY + cosf(lineHeading) * _config.startLateral;
+        _heading = lineHeading + _config.startHeading;
+
+        _angularSpeed = 0;
+        _speed = _acceleration = 0;
+        _leftSpeed = _rightSpeed = 0;
+        _leftTarget = _rightTarget = 0;
+        _motorState = COASTING;
+
+        _cursor = 0;
+        _barCursor = 0;
+        _progress = 0;
+        _lastPosition = 0;
+
+        _isRunning = false;
+        _rightMarkerPasses.clear();
+        _finishProgress = 0;
+        _brakeTime = -1;
+        _brakeProgress = 0;
+        _wasOffLine = false;
+        _result = SimulationResult();
+        updateSensors(false);
+    }
+
+    int readDigital(uint8_t pin) override {
+        if (pin == MIO) return readSensorDigital(selectedSensor());
+        if (pin == LEFT_HELPER_SENS) return _leftHelperLevel;
+        if (pin == RIGHT_HELPER_SENS) return _rightHelperLevel;
+        // Buttons are never pressed
+        return LOW;
+    }
+
+    uint16_t readAnalog(uint8_t pin) override {
+        if (pin != MIO) return SIM_ANALOG_BACKGROUND;
+        return readSensorAnalog(selectedSensor());
+    }
+
+    int16_t readGyroZ() override {
+        const float rate = _angularSpeed * RAD_TO_DEG + _gyroNoiseSample;
+        const float raw = rate * SIM_GYRO_LSB_PER_DPS;
+        return int16_t(constrain(raw, -32768.0f, 32767.0f));
+    }
+
+    int16_t readAccelX() override {
+        const float raw = _acceleration / GRAVITY_M_S2 * SIM_ACCEL_LSB_PER_G;
+        return int16_t(constrain(raw, -32768.0f, 32767.0f));
+    }
+
+    void drive(float leftOutput, float rightOutput) override {
+        setMotorCommand(TRACE_MOTOR_DRIVE, leftOutput, rightOutput);
+        _motorState = DRIVING;
+        _leftTarget = constrain(leftOutput, -1.0f, 1.0f) * MAX_WHEEL_SPEED_M_S;
+        _rightTarget = constrain(rightOutput, -1.0f, 1.0f) * MAX_WHEEL_SPEED_M_S;
+    }
+
+    void brake() override {
+        setMotorCommand(TRACE_MOTOR_BRAKE, 0, 0);
+        if (_motorState == DRIVING && _isRunning && _brakeTime < 0) {
+            _brakeTime = elapsedRunTime();
+            _brakeProgress = _progress;
+        }
+        _motorState = BRAKING;
+        _leftTarget = _rightTarget = 0;
+    }
+
+    void coast() override {
+        setMotorCommand(TRACE_MOTOR_COAST, 0, 0);
+        _motorState = COASTING;
+        _leftTarget = _rightTarget = 0;
+    }
+
+    void advance(uint64_t micros) override {
+        const uint64_t target = simhal::now() + micros;
+        while (_physicsTime + SIM_PHYSICS_STEP_US <= target) {
+            _physicsTime += SIM_PHYSICS_STEP_US;
+            simhal::setTime(_physicsTime);
+            step(SIM_PHYSICS_STEP_US / 1000000.0f);
+        }
+        simhal::setTime(target);
+    }
+
+    void startRun() {
+        _isRunning = true;
+        _runStartTime = simhal::now();
+    }
+
+    // Helper sensor edges are written here from now on
+    void setTrace(TraceWriter* trace) {
+        _trace = trace;
+    }
+
+    // Forgets the motor command, called before each control tick
+    void clearMotorCommand() {
+        setMotorCommand(TRACE_MOTOR_NONE, 0, 0);
+    }
+
+    // Fills a TRACE_CONTROL_TICK with what the firmware read in the tick that just ran and its motor command
+    void traceTick(TraceEvent& event) {
+        event.sensorDigital = 0;
+        for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+            if (readSensorDigital(i) == HIGH) event.sensorDigital |= 1 << i;
+            event.sensorAnalog[i] = readSensorAnalog(i);
+        }
+        event.gyroZ = readGyroZ();
+        event.accelX = readAccelX();
+        event.motorCommand = _motorCommand;
+        event.leftOutput = _leftOutput;
+        event.rightOutput = _rightOutput;
+    }
+
+    bool isDone() {
+        if (_result.lost) return true;
+        if (_isRunning && elapsedRunTime() >= _config.timeLimit) return true;
+
+        const bool isAtRest = fabsf(_leftSpeed) < 0.01f && fabsf(_rightSpeed) < 0.01f && fabsf(_speed) < 0.01f;
+        if (_brakeTime >= 0 && isAtRest) return true;
+
+        if (_rightMarkerPasses.size() >= 2 && _brakeTime < 0 &&
+            elapsedRunTime() - _rightMarkerPasses[1] >= SIM_FINISH_TIMEOUT_S) {
+            _result.missedFinish = true;
+            return true;
+        }
+        return false;
+    }
+
+    SimulationResult finishResult() {
+        if (_rightMarkerPasses.size() >= 2) {
+            _result.lapTime = _rightMarkerPasses[1] - _rightMarkerPasses[0];
+        }
+        if (_brakeTime >= 0) {
+            // The helper sensors sit ahead of the center that crossed the marker
+            const bool isPastFinish = _rightMarkerPasses.size() >= 2 &&
+                                      _brakeProgress >= _finishProgress - SIM_SENSOR_BAR_FORWARD_M - TRACK_MARKER_LENGTH_M;
+            _result.finished = isPastFinish;
+            _result.stoppedEarly = !isPastFinish;
+            if (_rightMarkerPasses.size() >= 2) _result.stopDistance = _progress - _finishProgress;
+        }
+        _result.simulatedTime = _isRunning ? elapsedRunTime() : 0;
+        return _result;
+    }
+
+   private:
+    enum MotorState {
+        COASTING,
+        DRIVING,
+        BRAKING
+    };
+
+    float elapsedRunTime() {
+        return (simhal::now() - _runStartTime) / 1000000.0f;
+    }
+
+    uint8_t selectedSensor() {
+        const uint8_t channel = simhal::outputLevel(MPLX_S0) << 2 |
+                                simhal::outputLevel(MPLX_S1) << 1 |
+                                simhal::outputLevel(MPLX_S2);
+        return MPLX_CHANNEL_SENSOR[channel];
+    }
+
+    int readSensorDigital(uint8_t sensorIndex) {
+        return getSensorCoverage(sensorIndex) >= 0.5f ? LOW : HIGH;
+    }
+
+    uint16_t readSensorAnalog(uint8_t sensorIndex) {
+        const float coverage = getSensorCoverage(sensorIndex);
+        return uint16_t(SIM_ANALOG_BACKGROUND - coverage * (SIM_ANALOG_BACKGROUND - SIM_ANALOG_LINE));
+    }
+
+    void setMotorCommand(TraceMotorCommand command, float leftOutput, float rightOutput) {
+        _motorCommand = command;
+        _leftOutput = leftOutput;
+        _rightOutput = rightOutput;
+    }
+
+    // Reports a helper sensor level to the HAL, tracing the changes its interrupt sees
+    void setHelperInput(uint8_t pin, uint8_t level, uint8_t& tracedLevel) {
+        if (_trace != NULL && level != tracedLevel) {
+            TraceEvent event = {};
+            event.time = simhal::now();
+            event.type = TRACE_HELPER_EDGE;
+            event.pin = pin;
+            event.level = level;
+            _trace->write(event);
+            tracedLevel = level;
+        }
+        simhal::updateInput(pin, level);
+    }
+
+    void step(float dt) {
+        const float timeConstant = _motorState == DRIVING   ? SIM_MOTOR_TIME_CONSTANT_S
+                                   : _motorState == BRAKING ? SIM_BRAKE_TIME_CONSTANT_S
+                                                            : SIM_COAST_TIME_CONSTANT_S;
+        _leftSpeed += (_leftTarget - _leftSpeed) * dt / timeConstant;
+        _rightSpeed += (_rightTarget - _rightSpeed) * dt / timeConstant;
+
+        // Past the grip limit the wheels spin or lock and the robot lags behind them
+        const float wheelSpeed = (_leftSpeed + _rightSpeed) / 2;
+        _acceleration = (wheelSpeed - _speed) / dt;
+        if (_config.gripLimit > 0) {
+            const bool isSliding = fabsf(wheelSpeed - _speed) > SIM_SLIDE_SPEED_M_S;
+            const float grip = isSliding ? _config.gripLimit * SIM_SLIDING_GRIP_FRACTION : _config.gripLimit;
+            _acceleration = constrain(_acceleration, -grip, grip);
+        }
+        _speed += _acceleration * dt;
+
+        const float speed = _speed;
+        _angularSpeed = (_rightSpeed - _leftSpeed) / SIM_WHEEL_TRACK_M;
+
+        // Past the grip limit the robot slides and turns less than its wheels ask for
+        const float lateralAcceleration = fabsf(speed * _angularSpeed);
+        if (_config.gripLimit > 0 && lateralAcceleration > _config.gripLimit) {
+            _angularSpeed *= _config.gripLimit / lateralAcceleration;
+        }
+
+        const float midHeading = _heading + _angularSpeed * dt / 2;
+        _x += speed * cosf(midHeading) * dt;
+        _y += speed * sinf(midHeading) * dt;
+        _heading += _angularSpeed * dt;
+
+        // One sample per step, every read of the step sees the same gyro
+        _gyroNoiseSample = _config.gyroNoise > 0 ? _gyroNoise(_random) : 0;
+
+        updateSensors(true);
+    }
+
+    // Fraction of a sensor that sees the line, only worked out when the firmware reads it
+    float getSensorCoverage(uint8_t sensorIndex) {
+        if (!_isSensorCoverageValid) {
+            // Sensor 0 is the leftmost one
+            const float edgeWidth = 0.004f;
+            for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+                const float left = (float(N_OF_SENSORS - 1) / 2 - i) * SIM_SENSOR_PITCH_M;
+                const TrackProjection sensor = _track.project(
+                    _barX - _sinHeading * left, _barY + _cosHeading * left, _barCursor, SIM_PROJECTION_WINDOW);
+                const float coverage = (_track.getLineWidth() / 2 - fabsf(sensor.lateral)) / edgeWidth + 0.5f;
+                _sensorCoverage[i] = constrain(coverage, 0.0f, 1.0f);
+            }
+            _isSensorCoverageValid = true;
+        }
+        return _sensorCoverage[sensorIndex];
+    }
+
+    void updateSensors(bool shouldTrackProgress) {
+        const TrackProjection center = _track.project(_x, _y, _cursor, SIM_PROJECTION_WINDOW);
+        _cursor = center.segment;
+        if (shouldTrackProgress) trackProgress(center);
+
+        _cosHeading = cosf(_heading);
+        _sinHeading = sinf(_heading);
+        _barX = _x + _cosHeading * SIM_SENSOR_BAR_FORWARD_M;
+        _barY = _y + _sinHeading * SIM_SENSOR_BAR_FORWARD_M;
+        const TrackProjection bar = _track.project(_barX, _barY, _barCursor, SIM_PROJECTION_WINDOW);
+        _barCursor = bar.segment;
+        _isSensorCoverageValid = false;
+
+        const TrackProjection leftHelper = _track.project(
+            _barX - _sinHeading * SIM_HELPER_LATERAL_M, _barY + _cosHeading * SIM_HELPER_LATERAL_M, _barCursor, SIM_PROJECTION_WINDOW);
+        const TrackProjection rightHelper = _track.project(
+            _barX + _sinHeading * SIM_HELPER_LATERAL_M, _barY - _cosHeading * SIM_HELPER_LATERAL_M, _barCursor, SIM_PROJECTION_WINDOW);
+
+        // White line, the sensors read LOW over it
+        const bool leftIsWhite = _track.isOnLine(leftHelper) || _track.isOnMarker(leftHelper, TrackMarker::LEFT);
+        const bool rightIsWhite = _track.isOnLine(rightHelper) || _track.isOnMarker(rightHelper, TrackMarker::RIGHT);
+        _leftHelperLevel = leftIsWhite ? LOW : HIGH;
+        _rightHelperLevel = rightIsWhite ? LOW : HIGH;
+        setHelperInput(LEFT_HELPER_SENS, _leftHelperLevel, _tracedLeftLevel);
+        setHelperInput(RIGHT_HELPER_SENS, _rightHelperLevel, _tracedRightLevel);
+
+        if (fabsf(center.lateral) > SIM_LOST_DISTANCE_M) _result.lost = true;
+
+        if (!_isRunning || _brakeTime >= 0) return;
+        if (fabsf(bar.lateral) > _result.maxDeviation) _result.maxDeviation = fabsf(bar.lateral);
+
+        // The whole bar is off the line once its center is further than its half width plus the line's
+        const float barHalfWidth = (N_OF_SENSORS - 1) * SIM_SENSOR_PITCH_M / 2;
+        const bool seesLine = fabsf(bar.lateral) <= barHalfWidth + _track.getLineWidth() / 2;
+        if (!seesLine) {
+            if (!_wasOffLine) _result.offLineExcursions++;
+            _result.offLineTime += SIM_PHYSICS_STEP_US / 1000000.0f;
+        }
+        _wasOffLine = !seesLine;
+    }
+
+    void trackProgress(const TrackProjection& center) {
+        float delta = center.position - _lastPosition;
+        if (_track.getIsClosed()) {
+            if (delta > _track.getLength() / 2) delta -= _track.getLength();
+            if (delta < -_track.getLength() / 2) delta += _track.getLength();
+        }
+
+        if (_isRunning && delta > 0) {
+            for (const TrackMarker& marker : _track.getMarkers()) {
+                if (marker.side != TrackMarker::RIGHT) continue;
+                const float markerDistance = _track.distanceAlong(_lastPosition, marker.position);
+                if (markerDistance <= 0 || markerDistance > delta) continue;
+
+                _rightMarkerPasses.push_back(elapsedRunTime());
+                if (_rightMarkerPasses.size() == 2) _finishProgress = _progress + markerDistance;
+            }
+        }
+
+        _progress += delta;
+        _lastPosition = center.position;
+    }
+
+    const SimulationConfig& _config;
+    const Track& _track;
+
+    std::mt19937 _random;
+    std::normal_distribution<float> _gyroNoise;
+    float _gyroNoiseSample = 0;
+
+    float _x, _y, _heading;
+    float _angularSpeed = 0;
+    float _speed = 0, _acceleration = 0;
+    float _leftSpeed = 0, _rightSpeed = 0;
+    float _leftTarget = 0, _rightTarget = 0;
+    MotorState _motorState = COASTING;
+    TraceMotorCommand _motorCommand = TRACE_MOTOR_NONE;
+    float _leftOutput = 0, _rightOutput = 0;
+    uint64_t _physicsTime = 0;
+
+    size_t _cursor;
+    size_t _barCursor;
+    float _cosHeading, _sinHeading;
+    float _barX, _barY;
+    float _sensorCoverage[N_OF_SENSORS];
+    bool _isSensorCoverageValid = false;
+    uint8_t _leftHelperLevel = HIGH;
+    uint8_t _rightHelperLevel = HIGH;
+
+    // Levels last written to the trace, the HAL starts every input LOW
+    TraceWriter* _trace = NULL;
+    uint8_t _tracedLeftLevel = LOW;
+    uint8_t _tracedRightLevel = LOW;
+
+    // Distance driven along the line, never wraps
+    float _progress = 0;
+    float _lastPosition;
+
+    bool _isRunning = false;
+    uint64_t _runStartTime = 0;
+    std::vector<float> _rightMarkerPasses;
+    float _finishProgress = 0;
+    float _brakeTime = -1;
+    float _brakeProgress = 0;
+    bool _wasOffLine = false;
+
+    SimulationResult _result;
+};
+
+}  // namespace
+
+void randomizeStart(SimulationConfig& config, uint32_t run) {
+    config.seed = run;
+    config.startLateral = 0;
+    config.startHeading = 0;
+    if (run <= 1) return;
+
+    std::mt19937 random(run);
+    std::uniform_real_distribution<float> unit(-1, 1);
+    config.startLateral = unit(random) * SIM_START_LATERAL_SPREAD_M;
+    config.startHeading = unit(random) * SIM_START_HEADING_SPREAD_RAD;
+}
+
+SpeedProfile simulationProfile(const SimulationConfig& config) {
+    if (config.profile != NULL) return *config.profile;
+
+    SpeedProfile profile = DEFAULT_PROFILES[config.mode];
+    memcpy(profile.sensorGains, config.sensorGains, sizeof(profile.sensorGains));
+    memcpy(profile.gyroGains, config.gyroGains, sizeof(profile.gyroGains));
+    return profile;
+}
+
+SimFirmware::SimFirmware(LineFollower::Modes mode, const SpeedProfile& profile)
+    : sensorArray(
+          MIO,
+          MPLX_S0,
+          MPLX_S1,
+          MPLX_S2,
+          LED_SELEC_1,
+          LED_SELEC_2,
+          LEFT_HELPER_SENS,
+          RIGHT_HELPER_SENS,
+          SensorArray::WHITE,
+          false),
+      gyro(GYRO_INT_PIN),
+      motors(STBY, AIN_2, AIN_1, PWM_A, BIN_1, BIN_2, PWM_B),
+      sensorPid(profile.sensorGains[0], profile.sensorGains[1], profile.sensorGains[2]),
+      gyroPid(profile.gyroGains[0], profile.gyroGains[1], profile.gyroGains[2]),
+      // USE_BLUETOOTH is never defined for the simulation
+      lineFollower(
+          sensorArray,
+          gyro,
+          sensorPid,
+          gyroPid,
+          motors,
+          STATUS_LED_1,
+          STATUS_LED_2,
+          INPUT_BTN_1,
+          INPUT_BTN_2) {
+    currentLineFollower = &lineFollower;
+
+    lineFollower.initialize();
+    attachInterrupt(LEFT_HELPER_SENS, leftHelperInterrupt, CHANGE);
+    attachInterrupt(RIGHT_HELPER_SENS, rightHelperInterrupt, CHANGE);
+
+    lineFollower.setProfile(mode, profile);
+    lineFollower.changeMode(mode);
+}
+
+SimFirmware::~SimFirmware() {
+    currentLineFollower = NULL;
+}
+
+namespace {
+
+// Starts a run SIM_START_DELAY_US from now and schedules the firmware tasks until the robot is done
+void driveRun(SimRobot& robot, LineFollower& lineFollower, TraceWriter& trace, FILE* telemetryFile, uint32_t& ticks) {
+    // Same schedule as the two ControlLoop tasks of the firmware
+    const uint64_t controlPeriod = 1000000UL / CONTROL_LOOP_RATE_HZ;
+    const uint64_t housekeepingPeriod = 1000000UL / HOUSEKEEPING_RATE_HZ;
+    uint64_t nextControlTick = (simhal::now() / controlPeriod + 1) * controlPeriod;
+    uint64_t nextHousekeepingTick = (simhal::now() / housekeepingPeriod + 1) * housekeepingPeriod;
+    const uint64_t startTime = simhal::now() + SIM_START_DELAY_US;
+    bool wasStarted = false;
+
+    while (!robot.isDone()) {
+        const bool isControlTick = nextControlTick <= nextHousekeepingTick;
+        const uint64_t nextTick = isControlTick ? nextControlTick : nextHousekeepingTick;
+        if (simhal::now() < nextTick) robot.advance(nextTick - simhal::now());
+
+        if (isControlTick) {
+            TraceEvent event = {};
+            event.time = simhal::now();
+            event.type = TRACE_CONTROL_TICK;
+            robot.clearMotorCommand();
+
+            lineFollower.run();
+            ticks++;
+
+            if (trace.getIsOpen()) {
+                robot.traceTick(event);
+                trace.write(event);
+            }
+            nextControlTick += controlPeriod;
+            // Ticks missed while run() was blocked are dropped, like the timer notifications
+            if (nextControlTick <= simhal::now()) {
+                nextControlTick = (simhal::now() / controlPeriod + 1) * controlPeriod;
+            }
+        } else {
+            TraceEvent event = {};
+            event.time = simhal::now();
+            if (!wasStarted && simhal::now() >= startTime) {
+                event.type = TRACE_START;
+                trace.write(event);
+
+                lineFollower.toggleMotorsAreActive();
+                robot.startRun();
+                wasStarted = true;
+            }
+            event.type = TRACE_HOUSEKEEPING_TICK;
+            trace.write(event);
+            lineFollower.runHousekeeping();
+
+            // Stands in for the BLE notifications sent by runHousekeeping on the robot
+            if (telemetryFile != NULL) {
+                uint8_t packet[SIM_TELEMETRY_PACKET_SIZE];
+                const uint16_t size = lineFollower.readTelemetryPacket(packet, sizeof(packet));
+                if (size > 0) {
+                    const uint8_t sizeBytes[2] = {uint8_t(size), uint8_t(size >> 8)};
+                    fwrite(sizeBytes, 1, 2, telemetryFile);
+                    fwrite(packet, 1, size, telemetryFile);
+                }
+            }
+            nextHousekeepingTick += housekeepingPeriod;
+            if (nextHousekeepingTick <= simhal::now()) {
+                nextHousekeepingTick = (simhal::now() / housekeepingPeriod + 1) * housekeepingPeriod;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+SimulationResult simulate(const SimulationConfig& config) {
+    SimRobot robot(config);
+    simhal::attach(&robot);
+    simhal::setSerialEnabled(config.verbose);
+
+    SimulationResult result;
+    uint32_t ticks = 0;
+
+    FILE* telemetryFile = NULL;
+    if (config.telemetryPath != NULL) {
+        telemetryFile = fopen(config.telemetryPath, "wb");
+        if (telemetryFile == NULL) fprintf(stderr, "Could not open %s\n", config.telemetryPath);
+    }
+    TraceWriter trace;
+    if (config.tracePath != NULL && trace.open(config.tracePath, config.mode)) robot.setTrace(&trace);
+    {
+        SimFirmware firmware(config.mode, simulationProfile(config));
+        LineFollower& lineFollower = firmware.lineFollower;
+
+        // The firmware maps the track on its first RACE run and replays the map on the next
+        float mappingLapTime = -1;
+        if (config.mode == LineFollower::RACE && config.shouldMapBeforeRace) {
+            driveRun(robot, lineFollower, trace, telemetryFile, ticks);
+            const SimulationResult mappingResult = robot.finishResult();
+            if (mappingResult.finished) {
+                mappingLapTime = mappingResult.lapTime;
+                robot.placeAtStart();
+            }
+        }
+        if (!robot.isDone()) driveRun(robot, lineFollower, trace, telemetryFile, ticks);
+
+        result = robot.finishResult();
+        result.mappingLapTime = mappingLapTime;
+        result.ticks = ticks;
+        result.slipEvents = lineFollower.getSlipEvents();
+        result.launchTime = lineFollower.getLaunchTime();
+
+        if (config.dumpPath != NULL) {
+            FILE* file = fopen(config.dumpPath, "wb");
+            if (file == NULL) {
+                fprintf(stderr, "Could not open %s\n", config.dumpPath);
+            } else {
+                FilePrint filePrint(file);
+                if (!lineFollower.dumpRunRecord(filePrint)) {
+                    // Lost or out of time with the motors still on, records can only be dumped once they are off
+                    lineFollower.toggleMotorsAreActive();
+                    lineFollower.run();
+                    lineFollower.dumpRunRecord(filePrint);
+                }
+                fclose(file);
+            }
+        }
+    }
+
+    if (telemetryFile != NULL) fclose(telemetryFile);
+    simhal::detach();
+    return result;
+}
@@ -0,0 +1,188 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_SIMULATION_H
+#define SIM_SIMULATION_H
+
+#include <stdint.h>
+
+#include "GlobalConsts.h"
+#include "Gyro.h"
+#include "LineFollower.h"
+#include "PIDestal.h"
+#include "ProfileStore.h"
+#include "SensorArray.h"
+#include "TB6612FNG.h"
+#include "Track.h"
+
+// Robot geometry, the sensor bar is centered on the robot
+#define SIM_WHEEL_TRACK_M 0.13f
+#define SIM_SENSOR_BAR_FORWARD_M 0.08f
+#define SIM_SENSOR_PITCH_M 0.012f
+#define SIM_HELPER_LATERAL_M 0.05f
+
+// First order response of the wheel speed to the motor output
+#define SIM_MOTOR_TIME_CONSTANT_S 0.04f
+#define SIM_BRAKE_TIME_CONSTANT_S 0.015f
+#define SIM_COAST_TIME_CONSTANT_S 0.3f
+
+// Wheels this much faster or slower than the robot are sliding and only keep part of the grip
+#define SIM_SLIDE_SPEED_M_S 0.05f
+#define SIM_SLIDING_GRIP_FRACTION 0.7f
+
+// One step per control tick, the robot moves at most a couple of millimeters
+#define SIM_PHYSICS_STEP_US 1000
+
+// MPU6050 at +/- 1000 degrees/sec and +/- 8g
+#define SIM_GYRO_LSB_PER_DPS 32.8f
+#define SIM_ACCEL_LSB_PER_G 4096.0f
+
+// Analog readings over the line and over the background
+#define SIM_ANALOG_LINE 400
+#define SIM_ANALOG_BACKGROUND 3600
+
+// Largest start pose error of the randomized runs
+#define SIM_START_LATERAL_SPREAD_M 0.005f
+#define SIM_START_HEADING_SPREAD_RAD 0.05f
+
+// Time between power on and the start command, enough for the calibration
+#define SIM_START_DELAY_US 200000
+
+// Telemetry packet size, the notification payload of the usual 247 bytes MTU
+#define SIM_TELEMETRY_PACKET_SIZE 244
+
+// Runs that drift this far from the line are given up
+#define SIM_LOST_DISTANCE_M 0.25f
+
+// Time the firmware has to stop after crossing the finish marker
+#define SIM_FINISH_TIMEOUT_S 3.0f
+
+struct SimulationConfig {
+    const Track* track = NULL;
+    LineFollower::Modes mode = LineFollower::MEDIUM;
+
+    float sensorGains[3] = {SENSOR_PID_KP, SENSOR_PID_KI, SENSOR_PID_KD};
+    float gyroGains[3] = {GYRO_PID_KP, GYRO_PID_KI, GYRO_PID_KD};
+
+    // Replaces the whole profile of the mode when set, gains included
+    const SpeedProfile* profile = NULL;
+
+    // Start pose relative to the first point of the line
+    float startLateral = 0;
+    float startHeading = 0;
+
+    // Standard deviation of the gyro noise (degrees/sec)
+    float gyroNoise = 0;
+    uint32_t seed = 1;
+
+    // Largest acceleration the tires hold, lateral or along the track (m/s2), 0 for perfect grip
+    float gripLimit = 0;
+
+    // Simulated seconds after the start command
+    float timeLimit = 60;
+
+    // Writes the run record here when set, see tools/decode_run.py
+    const char* dumpPath = NULL;
+
+    // Writes the telemetry packets here when set, each after its uint16 size, see tools/telemetry_receiver.py
+    const char* telemetryPath = NULL;
+
+    // Writes the inputs and motor commands of every tick here when set, see sim/Trace.h
+    const char* tracePath = NULL;
+
+    // In RACE, drives a mapping run first and reports the run that replays its map
+    bool shouldMapBeforeRace = true;
+
+    // Prints the firmware Serial output
+    bool verbose = false;
+};
+
+struct SimulationResult {
+    // Time between the first two right marker passes (s), negative if not completed
+    float lapTime = -1;
+
+    // Lap of the RACE mapping run (s), negative if there was none
+    float mappingLapTime = -1;
+
+    // The firmware braked after the finish marker
+    bool finished = false;
+
+    // The firmware braked before the finish marker
+    bool stoppedEarly = false;
+
+    // The robot crossed the finish marker and kept going
+    bool missedFinish = false;
+
+    // The robot left the track
+    bool lost = false;
+
+    // Times every sensor of the bar left the line, and for how long (s)
+    uint32_t offLineExcursions = 0;
+    float offLineTime = 0;
+
+    // Largest distance between the sensor bar center and the line (m)
+    float maxDeviation = 0;
+
+    // Slip events counted by the firmware
+    uint32_t slipEvents = 0;
+
+    // Time to the cruise speed reported by the firmware (s), negative if not reached
+    float launchTime = -1;
+
+    // Where the robot came to rest, measured from the finish marker (m)
+    float stopDistance = 0;
+
+    float simulatedTime = 0;
+    uint32_t ticks = 0;
+};
+
+/*
+    Sets the seed and start pose of the nth run of a series, the first
+    one starts centered on the line and the rest from random poses that
+    only depend on run
+*/
+void randomizeStart(SimulationConfig& config, uint32_t run);
+
+// Profile a run drives with, the default one of its mode with the gains of the config unless config.profile is set
+SpeedProfile simulationProfile(const SimulationConfig& config);
+
+/*
+    The objects main.cpp builds, wired to the board attached on the
+    calling thread and initialized like the robot at power on.
+
+    The profile replaces the one of mode, which is selected
+*/
+class SimFirmware {
+   public:
+    SimFirmware(LineFollower::Modes mode, const SpeedProfile& profile);
+    ~SimFirmware();
+
+    SensorArray sensorArray;
+    Gyro gyro;
+    Tb6612fng motors;
+    PIDestal sensorPid;
+    PIDestal gyroPid;
+    LineFollower lineFollower;
+};
+
+/*
+    Runs the unmodified LineFollower against a simulated robot on a track
+    until it stops, gets lost or reaches the time limit.
+
+    Every simulation keeps its state on the calling thread, so several can
+    run in parallel.
+*/
+SimulationResult simulate(const SimulationConfig& config);
+
+#endif  // SIM_SIMULATION_H
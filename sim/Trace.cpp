@@ -0,0 +1,86 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Trace.h"
+
+#include <string.h>
+
+namespace {
+
+const char TRACE_MAGIC[4] = {'L', 'F', 'T', 'R'};
+
+struct __attribute__((packed)) TraceHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t eventSize;
+    uint8_t mode;
+    uint8_t reserved[3];
+};
+
+}  // namespace
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+bool TraceWriter::open(const char* path, uint8_t mode) {
+    close();
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+
+    TraceHeader header = {};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.eventSize = sizeof(TraceEvent);
+    header.mode = mode;
+    fwrite(&header, sizeof(header), 1, file);
+    return true;
+}
+
+void TraceWriter::close() {
+    if (file == NULL) return;
+    fclose(file);
+    file = NULL;
+}
+
+void TraceWriter::write(const TraceEvent& event) {
+    if (file != NULL) fwrite(&event, sizeof(event), 1, file);
+}
+
+bool readTrace(const char* path, uint8_t& mode, std::vector<TraceEvent>& events) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+
+    TraceHeader header;
+    const bool hasHeader = fread(&header, sizeof(header), 1, file) == 1 &&
+                           memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) == 0;
+    if (!hasHeader || header.version != TRACE_VERSION || header.eventSize != sizeof(TraceEvent)) {
+        fprintf(stderr, "%s is not a version %d trace\n", path, TRACE_VERSION);
+        fclose(file);
+        return false;
+    }
+    mode = header.mode;
+
+    events.clear();
+    TraceEvent event;
+    while (fread(&event, sizeof(event), 1, file) == 1) events.push_back(event);
+    fclose(file);
+    return true;
+}
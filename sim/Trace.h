@@ -0,0 +1,106 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_TRACE_H
+#define SIM_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "GlobalConsts.h"
+
+#define TRACE_VERSION 1
+
+// What TraceEvent stands for
+enum TraceEventType : uint8_t {
+    // LineFollower::run(), with the inputs it read and the motor command it gave
+    TRACE_CONTROL_TICK,
+    TRACE_HOUSEKEEPING_TICK,
+    // The start command, sent right before a housekeeping tick
+    TRACE_START,
+    // A helper sensor changed level, its interrupt runs
+    TRACE_HELPER_EDGE
+};
+
+// Last motor command of a control tick
+enum TraceMotorCommand : uint8_t {
+    TRACE_MOTOR_NONE,
+    TRACE_MOTOR_DRIVE,
+    TRACE_MOTOR_BRAKE,
+    TRACE_MOTOR_COAST
+};
+
+/*
+    Something the firmware saw or did, little endian, 44 bytes.
+
+    Any change here must bump TRACE_VERSION
+*/
+struct __attribute__((packed)) TraceEvent {
+    // Simulated time (us)
+    uint64_t time;
+    uint8_t type;
+
+    // TRACE_HELPER_EDGE only
+    uint8_t pin;
+    uint8_t level;
+
+    // The rest is TRACE_CONTROL_TICK only, bit i is digitalRead() of sensor i
+    uint8_t sensorDigital;
+    uint16_t sensorAnalog[N_OF_SENSORS];
+    int16_t gyroZ;
+    int16_t accelX;
+
+    uint8_t motorCommand;
+    uint8_t reserved[3];
+    float leftOutput;
+    float rightOutput;
+};
+
+static_assert(sizeof(TraceEvent) == 44, "TraceEvent layout is part of the trace format");
+
+/*
+    Everything a simulated run fed the firmware, in order, and the motor
+    commands it got back. Replaying the inputs reproduces the run without
+    the robot model, see sim/Replay.h
+
+    File format:
+        char[4]   magic "LFTR"
+        uint16    TRACE_VERSION
+        uint16    sizeof(TraceEvent)
+        uint8     LineFollower::Modes of the run
+        uint8[3]  reserved
+        events    until the end of the file
+*/
+class TraceWriter {
+   public:
+    ~TraceWriter();
+
+    // Returns FALSE if the file could not be created
+    bool open(const char* path, uint8_t mode);
+    void close();
+
+    void write(const TraceEvent& event);
+
+    bool getIsOpen() { return file != NULL; }
+
+   private:
+    FILE* file = NULL;
+};
+
+// Returns FALSE, after printing why, if the file is not a trace of this version
+bool readTrace(const char* path, uint8_t& mode, std::vector<TraceEvent>& events);
+
+#endif  // SIM_TRACE_H
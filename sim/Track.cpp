@@ -0,0 +1,279 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Track.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+bool Track::loadFile(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+
+    std::vector<float> xs, ys;
+    std::vector<TrackMarker> fileMarkers;
+    bool fileIsClosed = false;
+    float fileLineWidth = TRACK_DEFAULT_LINE_WIDTH_M;
+
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(file, line); lineNumber++) {
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command)) continue;
+
+        bool isValid = false;
+        if (command == "point") {
+            float x, y;
+            isValid = static_cast<bool>(words >> x >> y);
+            if (isValid) {
+                xs.push_back(x);
+                ys.push_back(y);
+            }
+        } else if (command == "closed") {
+            fileIsClosed = isValid = true;
+        } else if (command == "width") {
+            isValid = static_cast<bool>(words >> fileLineWidth) && fileLineWidth > 0;
+        } else if (command == "marker") {
+            TrackMarker marker;
+            std::string side;
+            isValid = static_cast<bool>(words >> marker.position >> side) && (side == "left" || side == "right");
+            if (isValid) {
+                marker.side = side == "left" ? TrackMarker::LEFT : TrackMarker::RIGHT;
+                fileMarkers.push_back(marker);
+            }
+        }
+
+        if (!isValid) {
+            fprintf(stderr, "%s:%zu: invalid line \"%s\"\n", path, lineNumber, line.c_str());
+            return false;
+        }
+    }
+
+    if (xs.size() < 2) {
+        fprintf(stderr, "%s: a track needs at least two points\n", path);
+        return false;
+    }
+
+    isClosed = fileIsClosed;
+    lineWidth = fileLineWidth;
+    setPoints(xs, ys);
+    markers = fileMarkers;
+    return true;
+}
+
+void Track::buildStadium(float straightLength, float radius) {
+    std::vector<float> xs, ys;
+    const size_t arcSteps = 64;
+
+    // Bottom straight to the right, then counter clockwise around both ends
+    xs.push_back(0);
+    ys.push_back(0);
+    for (size_t i = 0; i < arcSteps; i++) {
+        const float angle = -M_PI / 2 + M_PI * i / arcSteps;
+        xs.push_back(straightLength + radius * cosf(angle));
+        ys.push_back(radius + radius * sinf(angle));
+    }
+    for (size_t i = 0; i < arcSteps; i++) {
+        const float angle = M_PI / 2 + M_PI * i / arcSteps;
+        xs.push_back(radius * cosf(angle));
+        ys.push_back(radius + radius * sinf(angle));
+    }
+
+    isClosed = true;
+    lineWidth = TRACK_DEFAULT_LINE_WIDTH_M;
+    setPoints(xs, ys);
+
+    TrackMarker startFinish;
+    startFinish.position = 0.25f;
+    startFinish.side = TrackMarker::RIGHT;
+    markers.clear();
+    markers.push_back(startFinish);
+}
+
+void Track::setPoints(const std::vector<float>& xs, const std::vector<float>& ys) {
+    pointX.clear();
+    pointY.clear();
+    pointPosition.clear();
+
+    const size_t numberOfInputSegments = isClosed ? xs.size() : xs.size() - 1;
+    float position = 0;
+
+    for (size_t i = 0; i < numberOfInputSegments; i++) {
+        const size_t next = (i + 1) % xs.size();
+        const float dx = xs[next] - xs[i];
+        const float dy = ys[next] - ys[i];
+        const float segmentLength = sqrtf(dx * dx + dy * dy);
+        const size_t steps = segmentLength > 0 ? size_t(ceilf(segmentLength / TRACK_MAX_SEGMENT_LENGTH_M)) : 0;
+
+        for (size_t step = 0; step < steps; step++) {
+            const float t = float(step) / steps;
+            pointX.push_back(xs[i] + dx * t);
+            pointY.push_back(ys[i] + dy * t);
+            pointPosition.push_back(position + segmentLength * t);
+        }
+        position += segmentLength;
+    }
+
+    // Open tracks keep their last point, closed ones wrap to the first
+    if (!isClosed) {
+        pointX.push_back(xs.back());
+        pointY.push_back(ys.back());
+        pointPosition.push_back(position);
+    }
+    length = position;
+
+    const size_t numberOfPoints = pointX.size();
+    const size_t numberOfSegments = isClosed ? numberOfPoints : numberOfPoints - 1;
+    directionX.resize(numberOfSegments);
+    directionY.resize(numberOfSegments);
+    segmentLength.resize(numberOfSegments);
+    for (size_t segment = 0; segment < numberOfSegments; segment++) {
+        const size_t next = (segment + 1) % numberOfPoints;
+        const float dx = pointX[next] - pointX[segment];
+        const float dy = pointY[next] - pointY[segment];
+        segmentLength[segment] = sqrtf(dx * dx + dy * dy);
+        directionX[segment] = segmentLength[segment] > 0 ? dx / segmentLength[segment] : 0;
+        directionY[segment] = segmentLength[segment] > 0 ? dy / segmentLength[segment] : 0;
+    }
+}
+
+TrackProjection Track::project(float x, float y, size_t hint, size_t window) const {
+    const size_t numberOfSegments = segmentLength.size();
+    if (hint >= numberOfSegments) hint = numberOfSegments - 1;
+
+    TrackProjection best;
+    float bestCross;
+    float bestDistanceSquared = projectOnSegment(x, y, hint, best, bestCross);
+
+    // The distance only grows moving away from the closest segment, walk towards it
+    for (int direction = 1; direction >= -1; direction -= 2) {
+        size_t segment = hint;
+        bool hasMoved = false;
+        for (size_t step = 0; step < window; step++) {
+            if (direction > 0) {
+                if (segment + 1 < numberOfSegments) {
+                    segment++;
+                } else if (isClosed) {
+                    segment = 0;
+                } else {
+                    break;
+                }
+            } else {
+                if (segment > 0) {
+                    segment--;
+                } else if (isClosed) {
+                    segment = numberOfSegments - 1;
+                } else {
+                    break;
+                }
+            }
+
+            TrackProjection candidate;
+            float candidateCross;
+            const float distanceSquared = projectOnSegment(x, y, segment, candidate, candidateCross);
+            if (distanceSquared >= bestDistanceSquared) break;
+            bestDistanceSquared = distanceSquared;
+            best = candidate;
+            bestCross = candidateCross;
+            hasMoved = true;
+        }
+        if (hasMoved) break;
+    }
+
+    // Cross product sign, positive to the left
+    const float distance = sqrtf(bestDistanceSquared);
+    best.lateral = bestCross >= 0 ? distance : -distance;
+    return best;
+}
+
+float Track::projectOnSegment(float x, float y, size_t segment, TrackProjection& projection, float& cross) const {
+    const float offsetX = x - pointX[segment];
+    const float offsetY = y - pointY[segment];
+    float along = offsetX * directionX[segment] + offsetY * directionY[segment];
+    if (along < 0) along = 0;
+    if (along > segmentLength[segment]) along = segmentLength[segment];
+
+    projection.segment = segment;
+    projection.position = pointPosition[segment] + along;
+    cross = directionX[segment] * offsetY - directionY[segment] * offsetX;
+
+    const float closestX = offsetX - directionX[segment] * along;
+    const float closestY = offsetY - directionY[segment] * along;
+    return closestX * closestX + closestY * closestY;
+}
+
+bool Track::isOnLine(const TrackProjection& projection) const {
+    return fabsf(projection.lateral) <= lineWidth / 2;
+}
+
+bool Track::isOnMarker(const TrackProjection& projection, TrackMarker::Side side) const {
+    const float sideLateral = side == TrackMarker::LEFT ? projection.lateral : -projection.lateral;
+    if (sideLateral < TRACK_MARKER_INNER_OFFSET_M || sideLateral > TRACK_MARKER_OUTER_OFFSET_M) return false;
+
+    for (const TrackMarker& marker : markers) {
+        if (marker.side != side) continue;
+        float distance = fabsf(projection.position - marker.position);
+        if (isClosed && distance > length / 2) distance = length - distance;
+        if (distance <= TRACK_MARKER_LENGTH_M / 2) return true;
+    }
+    return false;
+}
+
+void Track::getPoseAt(float position, float& x, float& y, float& heading) const {
+    if (isClosed) {
+        position = fmodf(position, length);
+        if (position < 0) position += length;
+    }
+
+    size_t segment = 0;
+    while (segment + 1 < segmentLength.size() && pointPosition[segment + 1] <= position) segment++;
+    const float along = fminf(fmaxf(position - pointPosition[segment], 0.0f), segmentLength[segment]);
+
+    x = pointX[segment] + directionX[segment] * along;
+    y = pointY[segment] + directionY[segment] * along;
+    heading = atan2f(directionY[segment], directionX[segment]);
+}
+
+float Track::distanceAlong(float from, float to) const {
+    float distance = to - from;
+    if (isClosed && distance < 0) distance += length;
+    return distance;
+}
+
+float Track::getLength() const {
+    return length;
+}
+
+float Track::getLineWidth() const {
+    return lineWidth;
+}
+
+bool Track::getIsClosed() const {
+    return isClosed;
+}
+
+const std::vector<TrackMarker>& Track::getMarkers() const {
+    return markers;
+}
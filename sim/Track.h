@@ -0,0 +1,120 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_TRACK_H
+#define SIM_TRACK_H
+
+#include <stddef.h>
+
+#include <vector>
+
+#define TRACK_DEFAULT_LINE_WIDTH_M 0.019f
+
+// Points are resampled so no segment is longer than this
+#define TRACK_MAX_SEGMENT_LENGTH_M 0.01f
+
+// Marker patch, measured from the line center
+#define TRACK_MARKER_LENGTH_M 0.02f
+#define TRACK_MARKER_INNER_OFFSET_M 0.03f
+#define TRACK_MARKER_OUTER_OFFSET_M 0.07f
+
+struct TrackMarker {
+    enum Side {
+        LEFT,
+        RIGHT
+    };
+
+    // Distance along the line (m)
+    float position;
+    Side side;
+};
+
+// Where a point is relative to the line
+struct TrackProjection {
+    size_t segment;
+
+    // Distance along the line (m)
+    float position;
+
+    // Signed distance to the line, positive to the left of the direction of travel (m)
+    float lateral;
+};
+
+/*
+    White line described as a polyline plus the start/finish and curve
+    markers next to it.
+
+    Text format, one command per line, '#' starts a comment:
+        point <x> <y>           meters, in the direction of travel
+        closed                  joins the last point to the first one
+        width <meters>          line width
+        marker <s> left|right   marker centered <s> meters along the line
+*/
+class Track {
+   public:
+    // Returns FALSE and prints the offending line if the file is invalid
+    bool loadFile(const char* path);
+
+    /*
+        Closed track with two straights joined by half circles, driven
+        counter clockwise, starting at the beginning of the bottom straight.
+        One right marker works as both the start and the finish line.
+    */
+    void buildStadium(float straightLength, float radius);
+
+    /*
+        Projects a point on the line, walking at most window segments
+        from hint so the other side of the track is never taken for the
+        closest one. The hint should be the segment of a nearby point.
+    */
+    TrackProjection project(float x, float y, size_t hint, size_t window) const;
+
+    bool isOnLine(const TrackProjection& projection) const;
+    bool isOnMarker(const TrackProjection& projection, TrackMarker::Side side) const;
+
+    // Point and heading (rad) at a distance along the line
+    void getPoseAt(float position, float& x, float& y, float& heading) const;
+
+    // Distance from a to b going forward, wrapping on closed tracks
+    float distanceAlong(float from, float to) const;
+
+    float getLength() const;
+    float getLineWidth() const;
+    bool getIsClosed() const;
+    const std::vector<TrackMarker>& getMarkers() const;
+
+   private:
+    // Returns the squared distance to the segment
+    float projectOnSegment(float x, float y, size_t segment, TrackProjection& projection, float& cross) const;
+
+    void setPoints(const std::vector<float>& xs, const std::vector<float>& ys);
+
+    std::vector<float> pointX;
+    std::vector<float> pointY;
+
+    // Distance along the line at each point
+    std::vector<float> pointPosition;
+
+    // Unit vector and length of the segment starting at each point
+    std::vector<float> directionX;
+    std::vector<float> directionY;
+    std::vector<float> segmentLength;
+
+    std::vector<TrackMarker> markers;
+    float lineWidth = TRACK_DEFAULT_LINE_WIDTH_M;
+    float length = 0;
+    bool isClosed = false;
+};
+
+#endif  // SIM_TRACK_H
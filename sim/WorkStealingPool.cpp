@@ -0,0 +1,100 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "WorkStealingPool.h"
+
+namespace {
+
+// Index of the worker running on this thread, -1 on any other thread
+thread_local int32_t currentWorker = -1;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(uint32_t numberOfThreads) {
+    if (numberOfThreads == 0) numberOfThreads = std::thread::hardware_concurrency();
+    if (numberOfThreads == 0) numberOfThreads = 1;
+
+    for (uint32_t i = 0; i < numberOfThreads; i++) workers.emplace_back(new Worker());
+    for (uint32_t i = 0; i < numberOfThreads; i++) threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        isStopping = true;
+    }
+    taskAvailable.notify_all();
+    for (std::thread& thread : threads) thread.join();
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    const uint32_t index = currentWorker >= 0 ? currentWorker : nextWorker++ % workers.size();
+    {
+        std::lock_guard<std::mutex> workerLock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    queuedTasks++;
+    unfinishedTasks++;
+    taskAvailable.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return unfinishedTasks == 0; });
+}
+
+bool WorkStealingPool::takeTask(uint32_t index, std::function<void()>& task) {
+    {
+        Worker& own = *workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queuedTasks--;
+            return true;
+        }
+    }
+
+    for (uint32_t offset = 1; offset < workers.size(); offset++) {
+        Worker& victim = *workers[(index + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queuedTasks--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(uint32_t index) {
+    currentWorker = index;
+    std::function<void()> task;
+    while (true) {
+        if (takeTask(index, task)) {
+            task();
+            task = nullptr;
+
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--unfinishedTasks == 0) allDone.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        taskAvailable.wait(lock, [this] { return isStopping || queuedTasks > 0; });
+        if (isStopping && queuedTasks == 0) return;
+    }
+}
@@ -0,0 +1,78 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_WORK_STEALING_POOL_H
+#define SIM_WORK_STEALING_POOL_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    Runs tasks on a fixed set of threads, each with its own queue.
+
+    A worker takes the newest task of its own queue and, once that is
+    empty, steals the oldest one from another worker, so uneven tasks
+    (a simulation that gets lost early next to one that runs the whole
+    lap) keep every core busy. Tasks submitted by a worker go to its own
+    queue, the others are spread over the workers.
+*/
+class WorkStealingPool {
+   public:
+    // With 0 threads there is one for each hardware thread
+    explicit WorkStealingPool(uint32_t numberOfThreads = 0);
+    ~WorkStealingPool();
+
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has run
+    void wait();
+
+    uint32_t getNumberOfThreads() { return threads.size(); }
+
+   private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(uint32_t index);
+
+    // Takes a task from the worker's own queue or steals one, returns FALSE if every queue is empty
+    bool takeTask(uint32_t index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    // Guards the counters the condition variables wait on
+    std::mutex stateMutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allDone;
+
+    // Tasks in the queues, and tasks submitted but not finished yet
+    std::atomic<uint32_t> queuedTasks{0};
+    uint32_t unfinishedTasks = 0;
+
+    uint32_t nextWorker = 0;
+    bool isStopping = false;
+};
+
+#endif  // SIM_WORK_STEALING_POOL_H
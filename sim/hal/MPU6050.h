@@ -0,0 +1,65 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_MPU6050_H
+#define SIM_MPU6050_H
+
+#include <stdint.h>
+
+#define MPU6050_INTMODE_ACTIVEHIGH 0x00
+#define MPU6050_INTDRV_PUSHPULL 0x00
+#define MPU6050_INTLATCH_50USPULSE 0x00
+#define MPU6050_INTCLEAR_ANYREAD 0x01
+
+// Only the gyro Z and accelerometer X registers are simulated, offsets are just stored
+class MPU6050 {
+   public:
+    void initialize() {}
+    bool testConnection() { return true; }
+    void setFullScaleGyroRange(uint8_t range) {}
+    void setFullScaleAccelRange(uint8_t range) {}
+    void setDLPFMode(uint8_t mode) {}
+    void setRate(uint8_t rate) {}
+
+    void setInterruptMode(bool mode) {}
+    void setInterruptDrive(bool drive) {}
+    void setInterruptLatch(bool latch) {}
+    void setInterruptLatchClear(bool clear) {}
+    void setIntDataReadyEnabled(bool enabled) {}
+
+    void CalibrateAccel(uint8_t loops) {}
+    void CalibrateGyro(uint8_t loops) {}
+    void PrintActiveOffsets() {}
+
+    int16_t getRotationZ();
+    int16_t getAccelerationX();
+
+    int16_t getXAccelOffset() { return offsets[0]; }
+    int16_t getYAccelOffset() { return offsets[1]; }
+    int16_t getZAccelOffset() { return offsets[2]; }
+    int16_t getXGyroOffset() { return offsets[3]; }
+    int16_t getYGyroOffset() { return offsets[4]; }
+    int16_t getZGyroOffset() { return offsets[5]; }
+    void setXAccelOffset(int16_t offset) { offsets[0] = offset; }
+    void setYAccelOffset(int16_t offset) { offsets[1] = offset; }
+    void setZAccelOffset(int16_t offset) { offsets[2] = offset; }
+    void setXGyroOffset(int16_t offset) { offsets[3] = offset; }
+    void setYGyroOffset(int16_t offset) { offsets[4] = offset; }
+    void setZGyroOffset(int16_t offset) { offsets[5] = offset; }
+
+   private:
+    int16_t offsets[6] = {0, 0, 0, 0, 0, 0};
+};
+
+#endif  // SIM_MPU6050_H
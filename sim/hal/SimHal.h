@@ -0,0 +1,71 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <stdint.h>
+
+/*
+    Hardware seen by the firmware when it runs on the host.
+
+    The HAL stand-ins forward every pin, gyro and motor access to the
+    board installed on the calling thread, so several simulations can run
+    side by side on different threads.
+*/
+class SimBoard {
+   public:
+    virtual ~SimBoard() {}
+
+    virtual int readDigital(uint8_t pin) = 0;
+    virtual uint16_t readAnalog(uint8_t pin) = 0;
+
+    // Raw MPU6050 gyro Z register
+    virtual int16_t readGyroZ() = 0;
+
+    // Raw MPU6050 accelerometer X register
+    virtual int16_t readAccelX() = 0;
+
+    virtual void drive(float leftOutput, float rightOutput) = 0;
+    virtual void brake() = 0;
+    virtual void coast() = 0;
+
+    // Moves the world forward while the firmware is blocked in delay()
+    virtual void advance(uint64_t micros) = 0;
+};
+
+namespace simhal {
+
+// Installs the board and resets the clock, pins, interrupts and NVS of this thread
+void attach(SimBoard* board);
+void detach();
+
+uint64_t now();
+void setTime(uint64_t micros);
+
+// Level last written to an output pin, by digitalWrite or the GPIO registers
+uint8_t outputLevel(uint8_t pin);
+
+/*
+    Reports the level of an input pin, running the interrupt attached to
+    it if the change matches its mode
+*/
+void updateInput(uint8_t pin, uint8_t level);
+
+// Prints the firmware Serial output on stderr when enabled
+void setSerialEnabled(bool enabled);
+
+}  // namespace simhal
+
+#endif  // SIM_HAL_H
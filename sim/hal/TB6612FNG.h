@@ -0,0 +1,31 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_TB6612FNG_H
+#define SIM_TB6612FNG_H
+
+#include <stdint.h>
+
+// Forwards the motor commands to the simulated robot
+class Tb6612fng {
+   public:
+    Tb6612fng(uint8_t standby, uint8_t in1A, uint8_t in2A, uint8_t pwmA, uint8_t in1B, uint8_t in2B, uint8_t pwmB) {}
+
+    void begin() {}
+    void drive(float outputA, float outputB);
+    void brake();
+    void coast();
+};
+
+#endif  // SIM_TB6612FNG_H
@@ -0,0 +1,34 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_GPIO_STRUCT_H
+#define SIM_GPIO_STRUCT_H
+
+#include <stdint.h>
+
+// Write-one-to-set/clear register that updates the simulated pin levels
+struct SimGpioRegister {
+    bool setsPins;
+
+    void operator=(uint32_t mask) const;
+};
+
+struct gpio_dev_t {
+    SimGpioRegister out_w1ts;
+    SimGpioRegister out_w1tc;
+};
+
+extern const gpio_dev_t GPIO;
+
+#endif  // SIM_GPIO_STRUCT_H
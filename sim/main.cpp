@@ -0,0 +1,305 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+    Runs the firmware LineFollower on the host, much faster than real time.
+
+    pio run -e native && .pio/build/native/program --mode fast --runs 20
+
+    With --replay it feeds a recorded trace to the firmware instead and
+    compares the motor commands with the golden ones, see sim/Replay.h
+
+    With --optimize it searches the profile of the mode for the fastest
+    laps, see sim/Optimizer.h
+
+    With --benchmark it times the steering policies, see include/Steering.h
+*/
+
+// pio test builds the sources with the main() of each test under test/
+#ifndef PIO_UNIT_TESTING
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "Optimizer.h"
+#include "Replay.h"
+#include "SimHal.h"
+#include "Simulation.h"
+#include "Steering.h"
+#include "Track.h"
+
+// Best candidates listed after a search
+#define SIM_OPT_PRINTED_CANDIDATES 10
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --track <file>        track description, defaults to a 2m x 1m stadium\n"
+            "  --mode <mode>         slow | medium | fast | race (default medium)\n"
+            "  --runs <n>            runs with randomized start pose and gyro noise (default 1, 3 per candidate)\n"
+            "  --gyro-noise <dps>    gyro noise standard deviation (default 0)\n"
+            "  --grip <m/s2>         acceleration the tires hold (default unlimited)\n"
+            "  --time-limit <s>      simulated time limit of each run (default 60)\n"
+            "  --dump <file>         writes the run record of the last run\n"
+            "  --telemetry <file>    writes the telemetry packets of the last run\n"
+            "  --record <file>       writes the trace of the last run, or of the replay\n"
+            "  --replay <file>       replays a trace instead of simulating\n"
+            "  --golden <file>       trace with the expected motor commands (default the replayed one)\n"
+            "  --repeat <n>          times the trace is replayed (default 1)\n"
+            "  --tolerance <output>  motor output difference that still matches (default 0)\n"
+            "  --optimize            searches the profile of the mode instead of simulating\n"
+            "  --param <name:min:max> profile field to search, see ProfileStore::findField (default the gains and offsets)\n"
+            "  --generations <n>     generations of the search (default 15)\n"
+            "  --population <n>      candidates of each generation (default 32)\n"
+            "  --threads <n>         simulation threads (default one per hardware thread)\n"
+            "  --benchmark <n>       prints the cycles of a steering tick, over n sweeps of the line\n"
+            "  --verbose             prints the firmware Serial output\n",
+            program);
+}
+
+static bool parseMode(const char* name, LineFollower::Modes& mode) {
+    if (strcmp(name, "slow") == 0) mode = LineFollower::SLOW;
+    else if (strcmp(name, "medium") == 0) mode = LineFollower::MEDIUM;
+    else if (strcmp(name, "fast") == 0) mode = LineFollower::FAST;
+    else if (strcmp(name, "race") == 0) mode = LineFollower::RACE;
+    else return false;
+    return true;
+}
+
+static const char* modeName(LineFollower::Modes mode) {
+    const char* names[] = {"slow", "medium", "fast", "race"};
+    return names[mode];
+}
+
+// name:min:max, with a name known to ProfileStore::findField
+static bool parseParameter(const char* text, OptimizerParameter& parameter) {
+    char name[32];
+    float min, max;
+    if (sscanf(text, "%31[^:]:%f:%f", name, &min, &max) != 3 || min > max) return false;
+
+    SpeedProfile profile = {};
+    if (ProfileStore::findField(profile, name) == NULL) return false;
+    parameter = OptimizerParameter{name, min, max};
+    return true;
+}
+
+static void printCandidate(const char* label, const OptimizerCandidate& candidate, const OptimizerConfig& config) {
+    printf("%-9s %7.3f  ", label, candidate.score);
+    if (candidate.meanLapTime >= 0) {
+        printf("%6.3fs", candidate.meanLapTime);
+    } else {
+        printf("%7s", "-");
+    }
+    printf("  %7.1fmm  %u/%u ", candidate.maxDeviation * 1000, candidate.finishedRuns, config.runsPerCandidate);
+    for (float value : candidate.values) printf(" %10.5g", value);
+    printf("\n");
+}
+
+static int printOptimization(OptimizerConfig& config) {
+    if (config.parameters.empty()) config.parameters = defaultOptimizerParameters(simulationProfile(config.simulation));
+
+    const std::vector<OptimizerCandidate> candidates = optimize(config);
+
+    printf("%-9s %7s  %7s  %9s  %-4s ", "rank", "score", "lap", "deviation", "runs");
+    for (const OptimizerParameter& parameter : config.parameters) printf(" %10s", parameter.name.c_str());
+    printf("\n");
+    for (size_t i = 0; i < candidates.size() && i < SIM_OPT_PRINTED_CANDIDATES; i++) {
+        char label[16];
+        snprintf(label, sizeof(label), "%zu", i + 1);
+        printCandidate(label, candidates[i], config);
+    }
+    for (const OptimizerCandidate& candidate : candidates) {
+        if (candidate.isReference) printCandidate("current", candidate, config);
+    }
+
+    const OptimizerCandidate& best = candidates.front();
+    if (best.finishedRuns == 0) return 2;
+
+    // The BLE "name=value" edits, applied to the profile of the selected mode
+    printf("\nbest %s profile:\n", modeName(config.simulation.mode));
+    for (size_t i = 0; i < config.parameters.size(); i++) {
+        printf("%s=%g\n", config.parameters[i].name.c_str(), best.values[i]);
+    }
+    return 0;
+}
+
+static int printReplay(const ReplayConfig& config) {
+    const ReplayResult result = replay(config);
+    if (!result.isValid) return 1;
+
+    printf("replay: %u ticks, ", result.ticks);
+    if (result.mismatchedTicks == 0) {
+        printf("every motor command matches");
+    } else {
+        printf("%u motor commands differ, the first at tick %d (%.3fs)", result.mismatchedTicks, result.firstMismatch, result.firstMismatchTime);
+    }
+    printf(", max output error %.6f, rms %.6f\n", result.maxOutputError, result.rmsOutputError);
+    printf("replayed %.0f ticks/s, %.2fus per tick\n", result.ticksPerSecond, result.ticksPerSecond > 0 ? 1000000 / result.ticksPerSecond : 0);
+
+    return result.mismatchedTicks == 0 ? 0 : 3;
+}
+
+static void printResult(uint32_t run, const SimulationResult& result) {
+    printf("run %u: ", run);
+    if (result.lapTime >= 0) {
+        printf("lap %.3fs", result.lapTime);
+    } else {
+        printf("no lap");
+    }
+
+    if (result.mappingLapTime >= 0) printf(" (mapping lap %.3fs)", result.mappingLapTime);
+    if (result.launchTime >= 0) printf(", launch %.3fs", result.launchTime);
+    if (result.finished) printf(", finished %.3fm after the line", result.stopDistance);
+    if (result.stoppedEarly) printf(", STOPPED EARLY");
+    if (result.missedFinish) printf(", MISSED FINISH");
+    if (result.lost) printf(", LOST");
+
+    printf(", %u off-line excursions (%.3fs), max deviation %.1fmm, %u slips\n",
+           result.offLineExcursions,
+           result.offLineTime,
+           result.maxDeviation * 1000,
+           result.slipEvents);
+}
+
+int main(int argc, char** argv) {
+    SimulationConfig config;
+    const char* trackPath = NULL;
+    const char* dumpPath = NULL;
+    const char* telemetryPath = NULL;
+    const char* recordPath = NULL;
+    ReplayConfig replayConfig;
+    OptimizerConfig optimizerConfig;
+    bool shouldOptimize = false;
+    // 0 until --runs is given
+    uint32_t runs = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--track") == 0 && hasValue) {
+            trackPath = argv[++i];
+        } else if (strcmp(argv[i], "--mode") == 0 && hasValue) {
+            if (!parseMode(argv[++i], config.mode)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--runs") == 0 && hasValue) {
+            runs = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--gyro-noise") == 0 && hasValue) {
+            config.gyroNoise = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--grip") == 0 && hasValue) {
+            config.gripLimit = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--time-limit") == 0 && hasValue) {
+            config.timeLimit = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--dump") == 0 && hasValue) {
+            dumpPath = argv[++i];
+        } else if (strcmp(argv[i], "--telemetry") == 0 && hasValue) {
+            telemetryPath = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && hasValue) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && hasValue) {
+            replayConfig.tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--golden") == 0 && hasValue) {
+            replayConfig.goldenPath = argv[++i];
+        } else if (strcmp(argv[i], "--repeat") == 0 && hasValue) {
+            replayConfig.repeat = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--tolerance") == 0 && hasValue) {
+            replayConfig.tolerance = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--optimize") == 0) {
+            shouldOptimize = true;
+        } else if (strcmp(argv[i], "--param") == 0 && hasValue) {
+            OptimizerParameter parameter;
+            if (!parseParameter(argv[++i], parameter)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            optimizerConfig.parameters.push_back(parameter);
+        } else if (strcmp(argv[i], "--generations") == 0 && hasValue) {
+            optimizerConfig.generations = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--population") == 0 && hasValue) {
+            optimizerConfig.populationSize = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            optimizerConfig.threads = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--benchmark") == 0 && hasValue) {
+            // Host nanoseconds stand in for the cycles
+            simhal::setSerialEnabled(true);
+            benchmarkSteering(strtoul(argv[++i], NULL, 10));
+            return 0;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            config.verbose = true;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (replayConfig.tracePath != NULL) {
+        replayConfig.outputPath = recordPath;
+        replayConfig.verbose = config.verbose;
+        return printReplay(replayConfig);
+    }
+
+    Track track;
+    if (trackPath != NULL) {
+        if (!track.loadFile(trackPath)) return 1;
+    } else {
+        track.buildStadium(2.0f, 0.5f);
+    }
+    config.track = &track;
+
+    if (shouldOptimize) {
+        optimizerConfig.simulation = config;
+        if (runs > 0) optimizerConfig.runsPerCandidate = runs;
+        return printOptimization(optimizerConfig);
+    }
+    if (runs == 0) runs = 1;
+    printf("track: %.2fm %s, %zu markers\n", track.getLength(), track.getIsClosed() ? "closed" : "open", track.getMarkers().size());
+
+    uint32_t finishedRuns = 0;
+    float totalLapTime = 0;
+    float bestLapTime = 0;
+    float simulatedTime = 0;
+
+    const auto wallStart = std::chrono::steady_clock::now();
+    for (uint32_t run = 1; run <= runs; run++) {
+        randomizeStart(config, run);
+        config.dumpPath = run == runs ? dumpPath : NULL;
+        config.telemetryPath = run == runs ? telemetryPath : NULL;
+        config.tracePath = run == runs ? recordPath : NULL;
+
+        const SimulationResult result = simulate(config);
+        printResult(run, result);
+
+        simulatedTime += result.simulatedTime;
+        if (result.finished && result.lapTime >= 0) {
+            finishedRuns++;
+            totalLapTime += result.lapTime;
+            if (bestLapTime == 0 || result.lapTime < bestLapTime) bestLapTime = result.lapTime;
+        }
+    }
+    const std::chrono::duration<float> wallTime = std::chrono::steady_clock::now() - wallStart;
+
+    printf("%u/%u runs finished", finishedRuns, runs);
+    if (finishedRuns > 0) printf(", mean lap %.3fs, best lap %.3fs", totalLapTime / finishedRuns, bestLapTime);
+    printf("\nsimulated %.1fs in %.3fs, %.0fx real time\n",
+           simulatedTime,
+           wallTime.count(),
+           wallTime.count() > 0 ? simulatedTime / wallTime.count() : 0);
+
+    return finishedRuns == runs ? 0 : 2;
+}
+
+#endif  // PIO_UNIT_TESTING
@@ -0,0 +1,66 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CalibrationStore.h"
+
+#include <Preferences.h>
+
+#include "esp_rom_crc.h"
+
+#define CALIBRATION_NAMESPACE "calibration"
+#define CALIBRATION_KEY "data"
+
+uint32_t CalibrationStore::calculateCrc(const StoredCalibration& stored) {
+    // Everything but the CRC itself
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&stored), offsetof(StoredCalibration, crc));
+}
+
+bool CalibrationStore::load(CalibrationData& data) {
+    Preferences preferences;
+    if (!preferences.begin(CALIBRATION_NAMESPACE, true)) return false;
+
+    StoredCalibration stored;
+    const bool sizeMatches = preferences.getBytesLength(CALIBRATION_KEY) == sizeof(stored);
+    const bool wasRead = sizeMatches && preferences.getBytes(CALIBRATION_KEY, &stored, sizeof(stored)) == sizeof(stored);
+    preferences.end();
+
+    if (!wasRead) return false;
+    if (stored.version != CALIBRATION_VERSION) return false;
+    if (stored.crc != calculateCrc(stored)) return false;
+
+    data = stored.data;
+    return true;
+}
+
+bool CalibrationStore::save(const CalibrationData& data) {
+    Preferences preferences;
+    if (!preferences.begin(CALIBRATION_NAMESPACE, false)) return false;
+
+    StoredCalibration stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.version = CALIBRATION_VERSION;
+    stored.data = data;
+    stored.crc = calculateCrc(stored);
+
+    const bool wasWritten = preferences.putBytes(CALIBRATION_KEY, &stored, sizeof(stored)) == sizeof(stored);
+    preferences.end();
+    return wasWritten;
+}
+
+void CalibrationStore::clear() {
+    Preferences preferences;
+    if (!preferences.begin(CALIBRATION_NAMESPACE, false)) return;
+    preferences.remove(CALIBRATION_KEY);
+    preferences.end();
+}
@@ -0,0 +1,33 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Clock.h"
+
+#include "esp_timer.h"
+
+int64_t SystemClock::now() {
+    return esp_timer_get_time();
+}
+
+int64_t ManualClock::now() {
+    return time;
+}
+
+void ManualClock::set(int64_t timestamp) {
+    time = timestamp;
+}
+
+void ManualClock::advance(int64_t microseconds) {
+    time += microseconds;
+}
@@ -0,0 +1,134 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ControlLoop.h"
+
+ControlLoop::ControlLoop(const char* name, TickFunction tickFunction, uint16_t rateHz) {
+    _name = name;
+    _tickFunction = tickFunction;
+    _periodMicros = 1000000UL / rateHz;
+}
+
+bool ControlLoop::begin(UBaseType_t priority, BaseType_t core, uint32_t stackSize) {
+    const BaseType_t taskCreated = xTaskCreatePinnedToCore(
+        taskEntry,
+        _name,
+        stackSize,
+        this,
+        priority,
+        &_taskHandle,
+        core);
+    if (taskCreated != pdPASS) return false;
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = timerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = _name;
+
+    if (esp_timer_create(&timerArgs, &_timerHandle) != ESP_OK) return false;
+    return esp_timer_start_periodic(_timerHandle, _periodMicros) == ESP_OK;
+}
+
+void ControlLoop::timerCallback(void* arg) {
+    ControlLoop* controlLoop = static_cast<ControlLoop*>(arg);
+    xTaskNotifyGive(controlLoop->_taskHandle);
+}
+
+void ControlLoop::taskEntry(void* arg) {
+    static_cast<ControlLoop*>(arg)->taskLoop();
+}
+
+void ControlLoop::taskLoop() {
+    int64_t lastStart = 0;
+
+    for (;;) {
+        // Each timer expiration adds one to the notification value, anything
+        // above one means the timer fired again before we got to run
+        const uint32_t pendingTicks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        const int64_t tickStart = esp_timer_get_time();
+        _tickFunction();
+        const uint32_t executionTime = esp_timer_get_time() - tickStart;
+
+        portENTER_CRITICAL(&_statsMux);
+        if (_shouldResetStats) {
+            _stats = ControlLoopStats();
+            _shouldResetStats = false;
+            lastStart = 0;
+        }
+        _stats.ticks++;
+        _stats.missedDeadlines += pendingTicks - 1;
+        if (executionTime > _periodMicros) _stats.overruns++;
+        if (executionTime > _stats.maxExecutionTime) _stats.maxExecutionTime = executionTime;
+
+        if (lastStart != 0) {
+            const uint32_t period = tickStart - lastStart;
+            const uint32_t jitter = period > _periodMicros
+                                        ? period - _periodMicros
+                                        : _periodMicros - period;
+            if (period < _stats.minPeriod) _stats.minPeriod = period;
+            if (period > _stats.maxPeriod) _stats.maxPeriod = period;
+            if (jitter > _stats.maxJitter) _stats.maxJitter = jitter;
+        }
+        portEXIT_CRITICAL(&_statsMux);
+
+        lastStart = tickStart;
+    }
+}
+
+void ControlLoop::resetStats() {
+    portENTER_CRITICAL(&_statsMux);
+    _shouldResetStats = true;
+    portEXIT_CRITICAL(&_statsMux);
+}
+
+ControlLoopStats ControlLoop::getStats() {
+    portENTER_CRITICAL(&_statsMux);
+    const ControlLoopStats statsCopy = _stats;
+    portEXIT_CRITICAL(&_statsMux);
+    return statsCopy;
+}
+
+uint32_t ControlLoop::getPeriodMicros() {
+    return _periodMicros;
+}
+
+void ControlLoop::printStats() {
+#ifdef SERIAL_DEBUG
+    const ControlLoopStats stats = getStats();
+    Serial.print(_name);
+    Serial.print("\t");
+    Serial.print("ticks: ");
+    Serial.print(stats.ticks);
+    Serial.print("\t");
+    Serial.print("missed: ");
+    Serial.print(stats.missedDeadlines);
+    Serial.print("\t");
+    Serial.print("overruns: ");
+    Serial.print(stats.overruns);
+    Serial.print("\t");
+    Serial.print("period: ");
+    Serial.print(stats.ticks > 1 ? stats.minPeriod : 0);
+    Serial.print("-");
+    Serial.print(stats.maxPeriod);
+    Serial.print("\t");
+    Serial.print("jitter: ");
+    Serial.print(stats.maxJitter);
+    Serial.print("\t");
+    Serial.print("exec: ");
+    Serial.print(stats.maxExecutionTime);
+    Serial.println();
+#endif
+}
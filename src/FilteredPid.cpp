@@ -0,0 +1,55 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "FilteredPid.h"
+
+// Period the gains are tuned for (s)
+#define PID_NOMINAL_DT_S (1.0f / CONTROL_LOOP_RATE_HZ)
+
+void FilteredPid::setGains(const float gains[3]) {
+    kp = gains[0];
+    ki = gains[1];
+    kd = gains[2];
+}
+
+void FilteredPid::reset() {
+    integral = 0;
+    derivative = 0;
+    lastMeasurement = 0;
+    lastOutput = 0;
+    hasMeasurement = false;
+}
+
+float FilteredPid::calculate(float error, float measurement, float dt, bool isSaturated) {
+    // A stalled tick must not turn into one huge step
+    if (dt > PID_MAX_DT_S) dt = PID_MAX_DT_S;
+
+    if (dt > 0 && hasMeasurement) {
+        const float ticks = dt / PID_NOMINAL_DT_S;
+
+        // Conditional integration, only towards the unsaturated side
+        const bool isWindingUp = isSaturated && error * lastOutput > 0;
+        if (!isWindingUp) integral += error * ticks;
+
+        const float rawDerivative = -(measurement - lastMeasurement) / ticks;
+        derivative += dt / (PID_DERIVATIVE_FILTER_S + dt) * (rawDerivative - derivative);
+    }
+    if (dt > 0 || !hasMeasurement) {
+        lastMeasurement = measurement;
+        hasMeasurement = true;
+    }
+
+    lastOutput = kp * error + ki * integral + kd * derivative;
+    return lastOutput;
+}
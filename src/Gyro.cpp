@@ -22,9 +22,13 @@ CW = Negative value
 CCW = Negative value
 
 */
-Gyro::Gyro() {
+Gyro::Gyro(int8_t interruptPin) {
+    dataReadyPin = interruptPin;
 }
 void Gyro::initialize() {
+    i2cMutex = xSemaphoreCreateMutex();
+    Wire.setClock(GYRO_I2C_CLOCK_HZ);
+
     accelGyro.initialize();
 
     /*
@@ -35,22 +39,169 @@ void Gyro::initialize() {
      * */
     accelGyro.setFullScaleGyroRange(2);
 
+    /*
+     * 0 = +/- 2g
+     * 1 = +/- 4g
+     * 2 = +/- 8g
+     * 3 = +/- 16g
+     * */
+    accelGyro.setFullScaleAccelRange(2);
+
+    accelGyro.setDLPFMode(GYRO_DLPF_MODE);
+    accelGyro.setRate(GYRO_SAMPLE_RATE_DIVIDER);
+
 #ifdef SERIAL_DEBUG
     Serial.println(accelGyro.testConnection() ? "MPU6050 connection successful" : "MPU6050 connection failed");
 #endif
+
+    if (dataReadyPin >= 0) {
+        // Short active high pulse on every new sample, configured before the
+        // acquisition task exists so nothing else is using the I2C bus yet
+        accelGyro.setInterruptMode(MPU6050_INTMODE_ACTIVEHIGH);
+        accelGyro.setInterruptDrive(MPU6050_INTDRV_PUSHPULL);
+        accelGyro.setInterruptLatch(MPU6050_INTLATCH_50USPULSE);
+        accelGyro.setInterruptLatchClear(MPU6050_INTCLEAR_ANYREAD);
+        accelGyro.setIntDataReadyEnabled(true);
+    }
+
+    if (xTaskCreatePinnedToCore(
+            acquisitionEntry,
+            "gyro",
+            GYRO_TASK_STACK_SIZE,
+            this,
+            GYRO_TASK_PRIORITY,
+            &acquisitionTask,
+            GYRO_TASK_CORE) != pdPASS) {
+        // update() reads the sensor itself
+        acquisitionTask = NULL;
+#ifdef SERIAL_DEBUG
+        Serial.println("Failed to start the gyro task, reading it on every update");
+#endif
+        return;
+    }
+
+    if (dataReadyPin >= 0) {
+        pinMode(dataReadyPin, INPUT);
+        attachInterruptArg(dataReadyPin, dataReadyInterrupt, this, RISING);
+    }
+}
+
+void IRAM_ATTR Gyro::dataReadyInterrupt(void* arg) {
+    Gyro* gyro = static_cast<Gyro*>(arg);
+
+    // The low 32 bits of the time travel in the notification value, a 64 bit
+    // variable shared with the other core could be read half written
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    xTaskNotifyFromISR(gyro->acquisitionTask, uint32_t(esp_timer_get_time()), eSetValueWithOverwrite,
+                       &higherPriorityTaskWoken);
+    if (higherPriorityTaskWoken) portYIELD_FROM_ISR();
+}
+
+void Gyro::acquisitionEntry(void* arg) {
+    static_cast<Gyro*>(arg)->acquisitionLoop();
+}
+
+void Gyro::acquisitionLoop() {
+    const TickType_t pollPeriod = pdMS_TO_TICKS(1000 / GYRO_SAMPLE_RATE_HZ) > 0
+                                      ? pdMS_TO_TICKS(1000 / GYRO_SAMPLE_RATE_HZ)
+                                      : 1;
+    acquisitionStartTime = esp_timer_get_time();
+
+    for (;;) {
+        bool isDataReady = false;
+        uint32_t dataReadyTime = 0;
+        if (dataReadyPin >= 0) {
+            // Falls back to polling if an interrupt is ever lost
+            isDataReady = xTaskNotifyWait(0, 0, &dataReadyTime, 2 * pollPeriod) == pdTRUE;
+        } else {
+            vTaskDelay(pollPeriod);
+        }
+
+        xSemaphoreTake(i2cMutex, portMAX_DELAY);
+        const int64_t readStart = esp_timer_get_time();
+        GyroSample sample;
+        sample.z = accelGyro.getRotationZ();
+        sample.accelX = accelGyro.getAccelerationX();
+        const int64_t readEnd = esp_timer_get_time();
+        xSemaphoreGive(i2cMutex);
+
+        // The interrupt is always less than 2^32 us before readStart
+        sample.timestamp = isDataReady ? readStart - uint32_t(uint32_t(readStart) - dataReadyTime) : readStart;
+        latestSample.write(sample);
+
+        const uint32_t readLatency = readEnd - readStart;
+        numberOfSamples.fetch_add(1, std::memory_order_relaxed);
+        totalReadLatency.fetch_add(readLatency, std::memory_order_relaxed);
+        if (readLatency > maxReadLatency.load(std::memory_order_relaxed)) {
+            maxReadLatency.store(readLatency, std::memory_order_relaxed);
+        }
+    }
+}
+
+GyroStats Gyro::getStats() {
+    GyroStats stats;
+    stats.samples = numberOfSamples.load(std::memory_order_relaxed);
+    stats.maxReadLatency = maxReadLatency.load(std::memory_order_relaxed);
+    stats.meanReadLatency = stats.samples ? totalReadLatency.load(std::memory_order_relaxed) / stats.samples : 0;
+
+    const int64_t elapsed = esp_timer_get_time() - acquisitionStartTime;
+    stats.sampleRate = elapsed > 0 ? stats.samples * 1000000.0f / elapsed : 0;
+    return stats;
+}
+
+void Gyro::printStats() {
+#ifdef SERIAL_DEBUG
+    const GyroStats stats = getStats();
+    Serial.print("gyro\t");
+    Serial.print("samples: ");
+    Serial.print(stats.samples);
+    Serial.print("\t");
+    Serial.print("rate: ");
+    Serial.print(stats.sampleRate);
+    Serial.print("\t");
+    Serial.print("read: ");
+    Serial.print(stats.meanReadLatency);
+    Serial.print("/");
+    Serial.print(stats.maxReadLatency);
+    Serial.println();
+#endif
 }
 
 bool Gyro::calibrate() {
+    xSemaphoreTake(i2cMutex, portMAX_DELAY);
     accelGyro.CalibrateAccel(6);
     accelGyro.CalibrateGyro(6);
 #ifdef SERIAL_DEBUG
     accelGyro.PrintActiveOffsets();
 #endif
-    update();
+    gyroscope.z = accelGyro.getRotationZ();
+    xSemaphoreGive(i2cMutex);
 
     return abs(gyroscope.z) <= 500 ? true : false;
 }
 
+void Gyro::getOffsets(int16_t accelOffset[3], int16_t gyroOffset[3]) {
+    xSemaphoreTake(i2cMutex, portMAX_DELAY);
+    accelOffset[0] = accelGyro.getXAccelOffset();
+    accelOffset[1] = accelGyro.getYAccelOffset();
+    accelOffset[2] = accelGyro.getZAccelOffset();
+    gyroOffset[0] = accelGyro.getXGyroOffset();
+    gyroOffset[1] = accelGyro.getYGyroOffset();
+    gyroOffset[2] = accelGyro.getZGyroOffset();
+    xSemaphoreGive(i2cMutex);
+}
+
+void Gyro::setOffsets(const int16_t accelOffset[3], const int16_t gyroOffset[3]) {
+    xSemaphoreTake(i2cMutex, portMAX_DELAY);
+    accelGyro.setXAccelOffset(accelOffset[0]);
+    accelGyro.setYAccelOffset(accelOffset[1]);
+    accelGyro.setZAccelOffset(accelOffset[2]);
+    accelGyro.setXGyroOffset(gyroOffset[0]);
+    accelGyro.setYGyroOffset(gyroOffset[1]);
+    accelGyro.setZGyroOffset(gyroOffset[2]);
+    xSemaphoreGive(i2cMutex);
+}
+
 void Gyro::printReadings() {
 #ifdef SERIAL_DEBUG
     Serial.print("a/g:\t");
@@ -68,13 +219,20 @@ void Gyro::printReadings() {
 #endif
 }
 
-void Gyro::update() {
-    accelGyro.getMotion6(
-        &accelerometer.x,
-        &accelerometer.y,
-        &accelerometer.z,
-        &gyroscope.x,
-        &gyroscope.y,
-        &gyroscope.z);
+void Gyro::update(int64_t tickTime) {
+    if (acquisitionTask == NULL) {
+        xSemaphoreTake(i2cMutex, portMAX_DELAY);
+        gyroscope.z = accelGyro.getRotationZ();
+        accelerometer.x = accelGyro.getAccelerationX();
+        xSemaphoreGive(i2cMutex);
+        sampleTimestamp = tickTime;
+    } else {
+        const GyroSample sample = latestSample.read();
+        gyroscope.z = sample.z;
+        accelerometer.x = sample.accelX;
+        sampleTimestamp = sample.timestamp;
+    }
     rotationSpeed = float(gyroscope.z) / 131.0f;
+    angularVelocity = float(gyroscope.z) / GYRO_LSB_PER_DPS * DEG_TO_RAD;
+    forwardAcceleration = ACCEL_FORWARD_SIGN * float(accelerometer.x) / ACCEL_LSB_PER_G * GRAVITY_M_S2;
 }
\ No newline at end of file
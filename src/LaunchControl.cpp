@@ -0,0 +1,75 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "LaunchControl.h"
+
+void LaunchControl::begin(int64_t timestamp, float restAccelerationReading) {
+    isLaunching = true;
+    isSpinning = false;
+    startTime = timestamp;
+    lastUpdateTime = timestamp;
+    curveTime = 0;
+    restAcceleration = restAccelerationReading;
+    bodySpeed = 0;
+    wheelSpeed = 0;
+    output = LAUNCH_START_OUTPUT;
+    launchTime.store(-1, std::memory_order_relaxed);
+}
+
+float LaunchControl::update(int64_t timestamp, float cruiseOutput, float forwardAcceleration) {
+    if (!isLaunching) return cruiseOutput;
+
+    const float elapsedTime = (timestamp - lastUpdateTime) / 1000000.0f;
+    lastUpdateTime = timestamp;
+
+    // The wheels follow the output given on the last tick
+    wheelSpeed += (output * MAX_WHEEL_SPEED_M_S - wheelSpeed) * constrain(elapsedTime / SLIP_TIME_CONSTANT_S, 0.0f, 1.0f);
+    bodySpeed += (forwardAcceleration - restAcceleration) * elapsedTime;
+    if (bodySpeed < 0) bodySpeed = 0;
+
+    const float launchDuration = (timestamp - startTime) / 1000000.0f;
+    const bool reachedCruise = bodySpeed >= LAUNCH_HANDOVER_FRACTION * cruiseOutput * MAX_WHEEL_SPEED_M_S;
+    if (reachedCruise || launchDuration >= LAUNCH_TIMEOUT_S) {
+        isLaunching = false;
+        isSpinning = false;
+        // A timed out launch never reached the cruise speed, its time stays negative
+        if (reachedCruise) launchTime.store(launchDuration, std::memory_order_relaxed);
+        return cruiseOutput;
+    }
+
+    isSpinning = wheelSpeed - bodySpeed > LAUNCH_SPIN_MARGIN_M_S;
+    if (isSpinning) {
+        curveTime -= LAUNCH_BACKOFF_RATE * elapsedTime;
+        if (curveTime < 0) curveTime = 0;
+    } else {
+        curveTime += elapsedTime;
+    }
+
+    const float progress = constrain(curveTime / LAUNCH_RAMP_TIME_S, 0.0f, 1.0f);
+    output = LAUNCH_START_OUTPUT + (cruiseOutput - LAUNCH_START_OUTPUT) * powf(progress, LAUNCH_RAMP_EXPONENT);
+    if (output > cruiseOutput) output = cruiseOutput;
+    return output;
+}
+
+bool LaunchControl::getIsLaunching() {
+    return isLaunching;
+}
+
+bool LaunchControl::getIsSpinning() {
+    return isSpinning;
+}
+
+float LaunchControl::getLaunchTime() {
+    return launchTime.load(std::memory_order_relaxed);
+}
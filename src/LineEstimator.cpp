@@ -0,0 +1,96 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "LineEstimator.h"
+
+LineEstimator::LineEstimator() {
+    reset();
+}
+
+void LineEstimator::reset() {
+    offset = 0;
+    heading = 0;
+    curvature = 0;
+
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t j = 0; j < 3; j++) covariance[i][j] = 0;
+    }
+    covariance[0][0] = LINE_ESTIMATOR_SENSOR_NOISE_M * LINE_ESTIMATOR_SENSOR_NOISE_M;
+    covariance[1][1] = 0.1f;
+    covariance[2][2] = 1.0f;
+}
+
+void LineEstimator::predict(float dt, float speed, float angularVelocity) {
+    /*
+        The bar sits SENSOR_BAR_DISTANCE_M ahead of the wheels, turning
+        left sweeps it to the left so the line moves to the right
+
+            offset'    = speed * heading - SENSOR_BAR_DISTANCE_M * angularVelocity
+            heading'   = speed * curvature - angularVelocity
+            curvature' = 0
+    */
+    offset += dt * (speed * heading - SENSOR_BAR_DISTANCE_M * angularVelocity);
+    heading += dt * (speed * curvature - angularVelocity);
+    offset = constrain(offset, -LINE_ESTIMATOR_MAX_OFFSET_M, LINE_ESTIMATOR_MAX_OFFSET_M);
+
+    // P = F P F' + Q, F = [1 a 0; 0 1 a; 0 0 1]
+    const float a = dt * speed;
+    float fp[3][3];
+    for (uint8_t j = 0; j < 3; j++) {
+        fp[0][j] = covariance[0][j] + a * covariance[1][j];
+        fp[1][j] = covariance[1][j] + a * covariance[2][j];
+        fp[2][j] = covariance[2][j];
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        covariance[i][0] = fp[i][0] + a * fp[i][1];
+        covariance[i][1] = fp[i][1] + a * fp[i][2];
+        covariance[i][2] = fp[i][2];
+    }
+
+    covariance[0][0] += dt * LINE_ESTIMATOR_OFFSET_NOISE * LINE_ESTIMATOR_OFFSET_NOISE;
+    covariance[1][1] += dt * LINE_ESTIMATOR_HEADING_NOISE * LINE_ESTIMATOR_HEADING_NOISE;
+    covariance[2][2] += dt * LINE_ESTIMATOR_CURVATURE_NOISE * LINE_ESTIMATOR_CURVATURE_NOISE;
+}
+
+void LineEstimator::correct(float measuredOffset) {
+    // Only the offset is measured, H = [1 0 0]
+    const float innovation = measuredOffset - offset;
+    const float innovationVariance = covariance[0][0] + LINE_ESTIMATOR_SENSOR_NOISE_M * LINE_ESTIMATOR_SENSOR_NOISE_M;
+
+    float gain[3];
+    for (uint8_t i = 0; i < 3; i++) gain[i] = covariance[i][0] / innovationVariance;
+
+    offset += gain[0] * innovation;
+    heading += gain[1] * innovation;
+    curvature += gain[2] * innovation;
+
+    // P = P - K H P, H P is the first row of P
+    float firstRow[3];
+    for (uint8_t j = 0; j < 3; j++) firstRow[j] = covariance[0][j];
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t j = 0; j < 3; j++) covariance[i][j] -= gain[i] * firstRow[j];
+    }
+}
+
+float LineEstimator::getOffset() {
+    return offset;
+}
+
+float LineEstimator::getHeading() {
+    return heading;
+}
+
+float LineEstimator::getCurvature() {
+    return curvature;
+}
@@ -14,6 +14,9 @@
 
 #include "LineFollower.h"
 
+#include "Profiler.h"
+#include "SensorPatterns.h"
+
 float invertedMap(float input, float inMin, float inMax, float outMin, float outMax) {
     // Invert the input value
     float invertedValue = inMax + inMin - input;
@@ -30,23 +33,33 @@ LineFollower::LineFollower(
     Tb6612fng& motorsRef,
 #ifdef USE_BLUETOOTH
     PIDestalRemoteBLE& remotePidRef,
+    PIDestal& remoteSensorPidRef,
+    PIDestal& remoteGyroPidRef,
 #endif
     uint8_t statusLed1,
     uint8_t statusLed2,
     uint8_t inputButton1,
-    uint8_t inputButton2) {
+    uint8_t inputButton2) : steering(sensorPidRef, gyroPidRef) {
     sensorArray = &sensArrRef;
     gyro = &gyroRef;
-    gyroPid = &gyroPidRef;
-    gyroPid->errorTolerance = 0;
-    sensorPid = &sensorPidRef;
-    sensorPid->errorTolerance = 0;
-    sensorPid->setUseDeltaTime(false);
-    gyroPid->setUseDeltaTime(false);
+    gyroPidRef.errorTolerance = 0;
+    sensorPidRef.errorTolerance = 0;
+    sensorPidRef.setUseDeltaTime(false);
+    gyroPidRef.setUseDeltaTime(false);
 
     motors = &motorsRef;
+    memcpy(profiles, DEFAULT_PROFILES, sizeof(profiles));
 #ifdef USE_BLUETOOTH
     remotePid = &remotePidRef;
+    remoteSensorPid = &remoteSensorPidRef;
+    remoteGyroPid = &remoteGyroPidRef;
+
+    postedSensorGains[0] = remoteSensorPid->kp;
+    postedSensorGains[1] = remoteSensorPid->ki;
+    postedSensorGains[2] = remoteSensorPid->kd;
+    postedGyroGains[0] = remoteGyroPid->kp;
+    postedGyroGains[1] = remoteGyroPid->ki;
+    postedGyroGains[2] = remoteGyroPid->kd;
 #endif
 
     led1Pin = statusLed1;
@@ -56,18 +69,44 @@ LineFollower::LineFollower(
 }
 
 void LineFollower::endRun() {
-    shouldStop = true;
-    crossedFinishLine = millis();
+    if (runState != RUNNING) return;
+    isLapFinished = lapStarted;
+    setRunState(STOPPING);
+}
+
+void LineFollower::setClock(Clock& clockRef) {
+    clock = &clockRef;
 }
 
 void LineFollower::initialize() {
 #ifdef USE_BLUETOOTH
     remotePid->initialize("VINHO_DIESEL", "Diesel");
+    if (!telemetryBle.initialize()) {
+#ifdef SERIAL_DEBUG
+        Serial.println("Failed to start the BLE telemetry");
+#endif
+    }
 #endif
 
     sensorArray->initialize();
     gyro->initialize();
 
+    if (loadCalibration()) {
+        isCalibrated = true;
+    }
+
+    if (!runRecorder.initialize()) {
+#ifdef SERIAL_DEBUG
+        Serial.println("Failed to allocate the run recorder");
+#endif
+    }
+
+    if (!trackMap.initialize()) {
+#ifdef SERIAL_DEBUG
+        Serial.println("Failed to allocate the track map");
+#endif
+    }
+
     pinMode(led1Pin, OUTPUT);
     pinMode(led2Pin, OUTPUT);
     pinMode(button1Pin, INPUT);
@@ -75,111 +114,350 @@ void LineFollower::initialize() {
 
     motors->begin();
 
+    if (!profileStore.load(profiles)) {
+#ifdef SERIAL_DEBUG
+        Serial.println("No valid profiles stored, using the defaults");
+#endif
+    }
     changeMode(MEDIUM);
 }
 
 void LineFollower::updateButtons() {
-    if (!gyroWasCalibrated) {
+    if (!isCalibrated) {
         return;
     }
     button1 = digitalRead(button1Pin);
     button2 = digitalRead(button2Pin);
 
+    // Holding both buttons forces a new calibration
+    if (button1 && button2) {
+        if (isButtonPressValid()) requestCalibration();
+        return;
+    }
     if (button1 && isButtonPressValid()) {
         toggleMotorsAreActive();
     }
     if (button2 && isButtonPressValid()) {
         switchMode();
-        Serial.println("AAAAAAAAA");
     }
 }
 
 bool LineFollower::isButtonPressValid() {
-    if (millis() > lastPressedButtonTime + 200) {
-        lastPressedButtonTime = millis();
+    if (housekeepingTime > lastPressedButtonTime + 200000) {
+        lastPressedButtonTime = housekeepingTime;
         return true;
     }
     return false;
 }
 
 void LineFollower::switchMode() {
-    switch (currentMode) {
+    switch (selectedMode) {
         case SLOW:
-            currentMode = MEDIUM;
+            changeMode(MEDIUM);
             break;
         case MEDIUM:
-            currentMode = FAST;
+            changeMode(FAST);
             break;
         case FAST:
-            currentMode = SLOW;
+            changeMode(RACE);
+            break;
+        case RACE:
+            changeMode(SLOW);
             break;
         default:
             break;
     }
 }
 
-void LineFollower::toggleMotorsAreActive() {
-    shouldStop = false;
-    delay(500);
-    motorsAreActive = !motorsAreActive;
-    shouldStop = false;
-}
-
-float LineFollower::calculateInput(bool sensorsProcessed[N_OF_SENSORS]) {
-    float total = 0.0f;
-    uint8_t numberOfActiveSensors = 0;
-    for (size_t i = 0; i < N_OF_SENSORS; i++) {
-        if (sensorsProcessed[i]) {
-            total += i;
-            numberOfActiveSensors++;
+void LineFollower::postCommand(const Command& command) {
+    if (!commandQueue.push(command)) {
+#ifdef SERIAL_DEBUG
+        Serial.println("Command queue is full, dropping command");
+#endif
+    }
+}
+
+void LineFollower::processCommands() {
+    Command command;
+    while (commandQueue.pop(command)) {
+        switch (command.type) {
+            case Command::TOGGLE_MOTORS:
+                applyToggleMotorsAreActive();
+                break;
+            case Command::SET_PROFILE:
+                applyProfile(command.mode, command.profile);
+                break;
+            case Command::CLEAR_TRACK_MAP:
+                if (!motorsAreActive) trackMap.clear();
+                break;
+            case Command::RECALIBRATE:
+                // Never while ARMED, the motors would start once the blocking gyro calibration returns
+                if (runState == IDLE || runState == BRAKED) {
+                    setRunState(IDLE);
+                    isCalibrated = false;
+                    isCalibratingSensors = false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void LineFollower::applyProfile(Modes mode, const SpeedProfile& profile) {
+    currentMode = mode;
+    activeProfile = profile;
+    steering.applyProfile(profile);
+}
+
+void LineFollower::requestCalibration() {
+    Command command;
+    command.type = Command::RECALIBRATE;
+    postCommand(command);
+}
+
+void LineFollower::clearTrackMap() {
+    Command command;
+    command.type = Command::CLEAR_TRACK_MAP;
+    postCommand(command);
+}
+
+bool LineFollower::loadCalibration() {
+    CalibrationData data;
+    if (!calibrationStore.load(data)) {
+#ifdef SERIAL_DEBUG
+        Serial.println("No valid calibration stored");
+#endif
+        return false;
+    }
+    gyro->setOffsets(data.accelOffset, data.gyroOffset);
+    sensorArray->setCalibration(data.minRead, data.maxRead, data.sensorsThreshold);
+    return true;
+}
+
+void LineFollower::saveCalibration() {
+    CalibrationData data;
+    gyro->getOffsets(data.accelOffset, data.gyroOffset);
+    sensorArray->getCalibration(data.minRead, data.maxRead, data.sensorsThreshold);
+    if (!calibrationStore.save(data)) {
+#ifdef SERIAL_DEBUG
+        Serial.println("Failed to store the calibration");
+#endif
+    }
+}
+
+void LineFollower::runCalibration() {
+    if (!isCalibratingSensors) {
+        digitalWrite(led1Pin, HIGH);
+        digitalWrite(led2Pin, HIGH);
+        if (!gyro->calibrate()) return;
+
+        // Digital sensors have fixed thresholds, there is nothing to sweep
+        if (sensorArray->readsAnalog) {
+            sensorArray->resetCalibration();
+            isCalibratingSensors = true;
+            sensorCalibrationStartTime = tickStartTime;
+
+            // Only the first LED stays on while sweeping
+            digitalWrite(led2Pin, LOW);
+            return;
         }
+    } else {
+        sensorArray->calibrateSensors(tickStartTime);
+        if (tickStartTime - sensorCalibrationStartTime < SENSOR_CALIBRATION_TIME_MS * 1000LL) return;
+        isCalibratingSensors = false;
+    }
+
+    saveCalibration();
+    digitalWrite(led1Pin, LOW);
+    digitalWrite(led2Pin, LOW);
+    isCalibrated = true;
+}
+
+void LineFollower::toggleMotorsAreActive() {
+    Command command;
+    command.type = Command::TOGGLE_MOTORS;
+    postCommand(command);
+}
+
+LineFollower::RunState LineFollower::getRunState() {
+    return runState;
+}
+
+void LineFollower::applyToggleMotorsAreActive() {
+    switch (runState) {
+        case IDLE:
+        case BRAKED:
+            // Still calibrating, the robot may be in hand
+            if (isCalibrated) setRunState(ARMED);
+            break;
+        case ARMED:
+        case RUNNING:
+        case STOPPING:
+            setRunState(IDLE);
+            break;
+    }
+}
+
+void LineFollower::setRunState(RunState newState) {
+    runState = newState;
+    runStateSince = tickStartTime;
+    motorsAreActive = newState == RUNNING || newState == STOPPING;
+    isRunning = newState != IDLE && newState != BRAKED;
+
+    if (newState == RUNNING) startRun();
+}
+
+void LineFollower::updateRunState() {
+    const int64_t timeInState = tickStartTime - runStateSince;
+    if (runState == ARMED && timeInState >= RUN_ARM_DELAY_MS * 1000LL) setRunState(RUNNING);
+    if (runState == STOPPING && timeInState >= RUN_STOP_DELAY_MS * 1000LL) setRunState(BRAKED);
+}
+
+void LineFollower::startRun() {
+    runRecorder.clear();
+    slipDetector.reset();
+    isTractionLimited = false;
+    // The first tick must not see the outputs the last run ended with
+    leftMotorOutput = 0;
+    rightMotorOutput = 0;
+    // Still standing, the reading is the offset of the accelerometer
+    launchControl.begin(tickStartTime, gyro->forwardAcceleration);
+    steering.reset();
+    lastSteeringUpdate = tickStartTime;
+}
+
+uint32_t LineFollower::getSlipEvents() {
+    return slipDetector.getSlipEvents();
+}
+
+float LineFollower::getLaunchTime() {
+    return launchControl.getLaunchTime();
+}
+
+uint16_t LineFollower::readTelemetryPacket(uint8_t* buffer, uint16_t capacity) {
+    return telemetry.readPacket(buffer, capacity, uint32_t(clock->now()));
+}
+
+bool LineFollower::dumpRunRecord(Print& output) {
+    if (isRunning) return false;
+    runRecorder.dump(output);
+    return true;
+}
+
+void LineFollower::recordTick() {
+    RunRecord runRecord;
+    runRecord.timestamp = uint32_t(tickStartTime);
+    memcpy(runRecord.sensorRaw, sensorArray->sensorRaw, sizeof(runRecord.sensorRaw));
+    runRecord.sensorProcessed = sensorArray->processedMask;
+    runRecord.flags = 0;
+    if (currentController == GYRO) runRecord.flags |= RUN_RECORD_GYRO_CONTROLLER;
+    if (isOutOfLine) runRecord.flags |= RUN_RECORD_OUT_OF_LINE;
+    if (sensorArray->leftSensProcessed) runRecord.flags |= RUN_RECORD_LEFT_HELPER;
+    if (sensorArray->rightSensProcessed) runRecord.flags |= RUN_RECORD_RIGHT_HELPER;
+    if (slipDetector.getIsSlipping()) runRecord.flags |= RUN_RECORD_SLIP;
+    runRecord.reserved = 0;
+    runRecord.sensorInput = sensorInput;
+    runRecord.rotSpeed = rotSpeed;
+    runRecord.sensorPidResult = sensorPidResult;
+    runRecord.gyroPidResult = gyroPidResult;
+    runRecord.leftMotorOutput = leftMotorOutput;
+    runRecord.rightMotorOutput = rightMotorOutput;
+
+    runRecorder.record(runRecord);
+}
+
+void LineFollower::streamTick() {
+    if (++ticksSinceTelemetry < TELEMETRY_DECIMATION) return;
+    ticksSinceTelemetry = 0;
+
+    TelemetrySample sample;
+    sample.timestamp = uint32_t(tickStartTime);
+    sample.channels[0] = quantizeTelemetry(sensorInput, 0);
+    sample.channels[1] = quantizeTelemetry(rotSpeed, 1);
+    sample.channels[2] = quantizeTelemetry(sensorPidResult, 2);
+    sample.channels[3] = quantizeTelemetry(gyroPidResult, 3);
+    sample.channels[4] = quantizeTelemetry(leftMotorOutput, 4);
+    sample.channels[5] = quantizeTelemetry(rightMotorOutput, 5);
+    telemetry.push(sample);
+}
+
+float LineFollower::calculateInput(uint8_t processedMask) {
+    const SensorPattern& pattern = SENSOR_PATTERNS[processedMask];
+#ifdef USE_ANALOG_CENTROID
+    float centroid;
+    const bool seesLine = sensorArray->calculateCentroid(centroid);
+    if (seesLine) {
+        lastValidSensorInput = centroid;
     }
-    if (numberOfActiveSensors) {
-        const float inputResult = total / float(numberOfActiveSensors);
-        lastValidSensorInput = inputResult;
+#else
+    const bool seesLine = pattern.activeSensors > 0;
+    if (seesLine) {
+        lastValidSensorInput = pattern.position;
     }
+#endif
 
-    if (numberOfActiveSensors == 0) {
+    if (!seesLine) {
         if (isOutOfLine == false) {
             isOutOfLine = true;
-            outOfLineStartingTime = millis();
+            outOfLineStartingTime = tickStartTime;
         }
     } else {
         isOutOfLine = false;
     }
-    if (numberOfActiveSensors >= 6 && motorsAreActive) {
-        lastCrossingTime = millis();
+    if (pattern.isCrossing && motorsAreActive) {
+        lastCrossingTime = tickStartTime;
     }
 
     return lastValidSensorInput;
 }
 
-float LineFollower::calculateTargetRotSpeed(float error) {
-    if (error == 0) return 0;
-    const float absError = abs(error);
-    const float signalError = error / absError;
-    currentController = absError > 3
-                            ? GYRO
-                            : SENSOR;
-
-    return (error * 70);
+void LineFollower::updateSteering() {
+    SteeringInput input;
+    input.lineError = sensorTarget - sensorInput;
+    input.seesLine = !isOutOfLine;
+    input.rotSpeed = rotSpeed;
+    input.angularVelocity = gyro->angularVelocity;
+    // Outputs of the last tick were applied during the elapsed time
+    input.speed = (leftMotorOutput + rightMotorOutput) / 2 * MAX_WHEEL_SPEED_M_S;
+    input.dt = (tickStartTime - lastSteeringUpdate) / 1000000.0f;
+    lastSteeringUpdate = tickStartTime;
+
+    steering.update(input);
+
+    const SteeringOutput& output = steering.output;
+    sensorPidResult = output.sensorPidResult;
+    gyroPidResult = output.gyroPidResult;
+    rotSpeedTarget = output.rotSpeedTarget;
+    pidResult = output.steering;
+    currentController = output.isGyroSteering ? GYRO : SENSOR;
 }
 
 void LineFollower::updateMotors() {
-    if (isOutOfLine) {
-        pidResult = gyroPidResult * errorGain;
+    // The outputs still hold what drove the motors since the last tick
+    const bool isSlipping = slipDetector.update(rightMotorOutput - leftMotorOutput, rotSpeed);
 
-    } else {
-        pidResult = sensorPidResult * 0.1;
+    // Until the launch is over it sets the forward output, turbo waits for the cruise speed
+    const float turboedMotorOffset = launchControl.getIsLaunching()
+                                         ? launchControl.update(tickStartTime, motorOffset, gyro->forwardAcceleration)
+                                         : getTurboOffset(motorOffset);
+
+    /*
+        While slipping the forward output ramps down, once the wheels grip
+        again it ramps back up to the offset, the steering is left alone
+    */
+    if (isSlipping) {
+        if (!isTractionLimited) tractionLimit = turboedMotorOffset;
+        isTractionLimited = true;
+        tractionLimit -= SLIP_OUTPUT_DROP_STEP;
+        if (tractionLimit < 0) tractionLimit = 0;
+    } else if (isTractionLimited) {
+        tractionLimit += SLIP_OUTPUT_RISE_STEP;
+        if (tractionLimit >= turboedMotorOffset) isTractionLimited = false;
     }
-    const float turboedMotorOffset = getTurboOffset(motorOffset);
-    leftMotorOutput = turboedMotorOffset - pidResult;
-    rightMotorOutput = turboedMotorOffset + pidResult;
+    const float forwardOutput = isTractionLimited ? tractionLimit : turboedMotorOffset;
 
-    if (leftMotorOutput > motorClamp) leftMotorOutput = motorClamp;
-    if (leftMotorOutput < -motorClamp) leftMotorOutput = -motorClamp;
-    if (rightMotorOutput > motorClamp) rightMotorOutput = motorClamp;
-    if (rightMotorOutput < -motorClamp) rightMotorOutput = -motorClamp;
+    steering.mix(forwardOutput, motorClamp, leftMotorOutput, rightMotorOutput);
 
     motors->drive(leftMotorOutput, rightMotorOutput);
 }
@@ -224,159 +502,409 @@ void LineFollower::printAll2() {
     Serial.print("Mode: ");
     Serial.print(currentMode);
     Serial.print("\t");
+    Serial.print("droppedEdges: ");
+    Serial.print(droppedHelperEvents.load(std::memory_order_relaxed));
+    Serial.print("\t");
+    Serial.print("droppedTelemetry: ");
+    Serial.print(telemetry.getDroppedSamples());
+    Serial.print("\t");
+    Serial.print("lowContrast: ");
+    Serial.print(sensorArray->lowContrastMask);
+    Serial.print("\t");
+    Serial.print("slips: ");
+    Serial.print(slipDetector.getSlipEvents());
+    Serial.print("\t");
+    Serial.print("launch: ");
+    Serial.print(launchControl.getLaunchTime(), 3);
+    Serial.print("\t");
     Serial.println();
 
 #endif
 }
 
-float LineFollower::calculateSensorReadingError(float error) {
-    if (error == 0) return 0;
-    float absError = abs(error);
-    float errorSignal = error / absError;
-    if (absError > 0 && absError <= 1) return error * 1.1;
-    if (absError > 1 && absError <= 2) return error * 1.0;
-    if (absError > 2 && absError <= 3) return error * 1.0;
-    if (absError > 3) return error * 1.1;
-
-    return error;
-}
-
 float LineFollower::calculateMotorOffset() {
-    return maxMotorOffset;
+    if (isUsingSpeedProfile) {
+        const float plannedSpeed = trackMap.getSpeedAt(lapDistance + RACE_LOOKAHEAD_M);
+        return constrain(plannedSpeed, RACE_MIN_SPEED_M_S, RACE_MAX_SPEED_M_S) / MAX_WHEEL_SPEED_M_S;
+    }
+    return activeProfile.maxMotorOffset;
     const float minMapRotSpeed = 5.0;
     const float maxMapRotSpeed = 90.0;
     const float constrainedRot = constrain(abs(rotSpeed), minMapRotSpeed, maxMapRotSpeed);
 
-    return invertedMap(constrainedRot, minMapRotSpeed, maxMapRotSpeed, minMotorOffset, maxMotorOffset);
+    return invertedMap(constrainedRot, minMapRotSpeed, maxMapRotSpeed, activeProfile.minMotorOffset, activeProfile.maxMotorOffset);
 }
 
-void LineFollower::triggeredInterruptRising(HelperSensorSide sensorSide) {
-    if (!motorsAreActive || sensorSide == LEFT) return;
+void IRAM_ATTR LineFollower::onHelperEdge(HelperSensorSide sensorSide, bool level, uint32_t timestamp) {
+    HelperEvent event;
+    event.timestamp = timestamp;
+    event.sensorSide = sensorSide;
+    event.level = level;
+    if (!helperEvents.push(event)) droppedHelperEvents.fetch_add(1, std::memory_order_relaxed);
+}
 
-    const unsigned int timeNow = millis();
-    if (timeNow - lastCrossingTime >= crossingTimeThreshold) {
-        numberOfRightSignals++;
-        if (numberOfRightSignals >= totalRightSignals) {
-            endRun();
+void LineFollower::processHelperEvents() {
+    HelperEvent event;
+    while (helperEvents.pop(event)) {
+        HelperState& helper = helperStates[event.sensorSide];
+        const bool isOnLine = sensorArray->lineColor == SensorArray::WHITE ? !event.level : event.level;
+        if (isOnLine == helper.isOnLine) continue;
+
+        helper.isOnLine = isOnLine;
+        if (isOnLine) {
+            helper.lineReachedAt = event.timestamp;
+            helper.wasCounted = false;
         }
     }
+
+    // Pulses that ended before the filter time never get here
+    for (uint8_t side = LEFT; side <= RIGHT; side++) {
+        HelperState& helper = helperStates[side];
+        if (helper.wasCounted || !helper.isOnLine) continue;
+        // Signed, the edge may have come in after the tick started
+        if (int32_t(uint32_t(tickStartTime) - helper.lineReachedAt) < HELPER_GLITCH_FILTER_US) continue;
+
+        helper.wasCounted = true;
+        if (side == RIGHT) holdMarker(helper.lineReachedAt);
+    }
+    confirmMarker();
+}
+
+void LineFollower::holdMarker(uint32_t timestamp) {
+    // A second pulse within the crossing window belongs to the same marker
+    if (!motorsAreActive || isMarkerPending) return;
+    isMarkerPending = true;
+    pendingMarkerTime = timestamp;
+    pendingMarkerDistance = lapDistance;
 }
 
-void LineFollower::triggeredInterruptFalling(HelperSensorSide sensorSide) {
-    if (!motorsAreActive || sensorSide == LEFT) return;
+void LineFollower::confirmMarker() {
+    if (!isMarkerPending) return;
+
+    // In tight curves the right helper sweeps over the main line while the bar sees it at its right end
+    const bool isLineUnderHelper = helperStates[RIGHT].isOnLine && sensorInput >= MARKER_MAX_LINE_POSITION;
+
+    // Crossings also reach the helper sensors, they may be seen just before or after the marker
+    const int32_t sinceCrossing = int32_t(pendingMarkerTime - uint32_t(lastCrossingTime));
+    const bool isNearCrossing = abs(sinceCrossing) < int32_t(crossingTimeThreshold) * 1000;
+
+    if (!motorsAreActive || isLineUnderHelper || isNearCrossing) {
+        isMarkerPending = false;
+        // The lap was started on this marker
+        if (numberOfRightSignals == 0) abandonLap();
+        return;
+    }
+
+    // The bar may reach a crossing a little after the helper
+    if (int32_t(uint32_t(tickStartTime) - pendingMarkerTime) < MARKER_CONFIRM_DELAY_MS * 1000) return;
+
+    isMarkerPending = false;
+    countMarker(pendingMarkerTime, pendingMarkerDistance);
+}
 
-    const unsigned int timeNow = micros();
+void LineFollower::countMarker(uint32_t timestamp, float distance) {
+    numberOfRightSignals++;
+    if (numberOfRightSignals >= totalRightSignals) {
+        finishedLapDistance = distance;
+        endRun();
+        // RUN_STOP_DELAY_MS counts from the marker, not from its confirmation
+        if (runState == STOPPING) runStateSince = tickStartTime - int32_t(uint32_t(tickStartTime) - timestamp);
+    }
+}
 
-    if (timeNow - lastInterrupt < 100) {
-        lastInterrupt = timeNow;
+void LineFollower::updateTrackMap() {
+    const float elapsedTime = (tickStartTime - lastTrackMapUpdate) / 1000000.0f;
+    lastTrackMapUpdate = tickStartTime;
+
+    // Past the finish line, the lap is over
+    if (runState == STOPPING) return;
+
+    // The first signal of the right helper sensor is the start line, the lap
+    // starts as soon as it is seen and is abandoned if it is not confirmed
+    if (!lapStarted) {
+        if (numberOfRightSignals == 0 && !isMarkerPending) return;
+        lapStarted = true;
+        isLapFinished = false;
+        lapDistance = 0;
+        if (currentMode == RACE) {
+            if (trackMap.getState() == TrackMap::READY) {
+                isUsingSpeedProfile = true;
+            } else {
+                trackMap.startRecording();
+            }
+        }
         return;
     }
-    lastInterrupt = timeNow;
-    if (millis() - lastCrossingTime >= crossingTimeThreshold) {
-        numberOfRightSignals++;
-        if (numberOfRightSignals >= totalRightSignals) {
-            endRun();
+
+    // Outputs of the last tick were applied during the elapsed time
+    const float speed = (leftMotorOutput + rightMotorOutput) / 2 * MAX_WHEEL_SPEED_M_S;
+    const float distance = speed > 0 ? speed * elapsedTime : 0;
+    lapDistance += distance;
+
+    trackMap.record(distance, gyro->angularVelocity * elapsedTime);
+}
+
+void LineFollower::abandonLap() {
+    if (!lapStarted) return;
+    lapStarted = false;
+    isUsingSpeedProfile = false;
+    if (trackMap.getState() == TrackMap::RECORDING) trackMap.clear();
+}
+
+void LineFollower::finishLap() {
+    if (!lapStarted) return;
+    lapStarted = false;
+    isUsingSpeedProfile = false;
+
+    if (trackMap.getState() == TrackMap::RECORDING) {
+        // A run stopped before the finish line only mapped part of the track
+        if (!isLapFinished) {
+            trackMap.clear();
+#ifdef SERIAL_DEBUG
+            Serial.println("Track map: discarded, the lap was not finished");
+#endif
+            return;
         }
+        const bool wasPlanned = trackMap.finishRecording(finishedLapDistance);
+#ifdef SERIAL_DEBUG
+        Serial.print("Track map: ");
+        Serial.print(wasPlanned ? "planned " : "discarded ");
+        Serial.print(trackMap.getNumberOfSegments());
+        Serial.println(" segments");
+#endif
     }
 }
 
-void LineFollower::updateMode() {
-    if (currentMode == SLOW) {
-        minMotorOffset = 0.6;
-        maxMotorOffset = 0.6;
+void LineFollower::updateModeLeds() {
+    // The control task owns the LEDs while the gyro is calibrating
+    if (!isCalibrated) {
+        modeLedsAreValid = false;
+        return;
+    }
+    if (modeLedsAreValid) return;
+
+    if (selectedMode == SLOW) {
         digitalWrite(led1Pin, LOW);
         digitalWrite(led2Pin, LOW);
     }
-    if (currentMode == MEDIUM) {
-        minMotorOffset = 0.4;
-        maxMotorOffset = 0.8;
+    if (selectedMode == MEDIUM) {
         digitalWrite(led1Pin, LOW);
         digitalWrite(led2Pin, HIGH);
     }
-    if (currentMode == FAST) {
-        minMotorOffset = 0.7;
-        maxMotorOffset = 1.0;
+    if (selectedMode == FAST) {
         digitalWrite(led1Pin, HIGH);
         digitalWrite(led2Pin, HIGH);
     }
+    if (selectedMode == RACE) {
+        digitalWrite(led1Pin, HIGH);
+        digitalWrite(led2Pin, LOW);
+    }
+    modeLedsAreValid = true;
 }
 
 float LineFollower::getTurboOffset(float offset) {
+    // The speed profile already is the fastest the track allows
+    if (isUsingSpeedProfile) return offset;
     const float adjustedOffset = offset * speedMultiplier;
-    return abs(sensorInput - sensorTarget) < 1 ? offset * 1.5 : offset;
+    return abs(sensorInput - sensorTarget) < activeProfile.turboMaxError ? offset * activeProfile.turboFactor : offset;
 }
 
 void LineFollower::changeMode(Modes newMode) {
-    currentMode = newMode;
+    selectedMode = newMode;
+    modeLedsAreValid = false;
+
+    postProfile();
 
 #ifdef USE_BLUETOOTH
     if (newMode == SLOW) remotePid->setExtraInfo("SLOW");
     if (newMode == MEDIUM) remotePid->setExtraInfo("MEDIUM");
     if (newMode == FAST) remotePid->setExtraInfo("FAST");
+    if (newMode == RACE) remotePid->setExtraInfo("RACE");
+    loadRemoteGains();
+#endif
+}
+
+void LineFollower::postProfile() {
+    Command command;
+    command.type = Command::SET_PROFILE;
+    command.mode = selectedMode;
+    command.profile = profiles[selectedMode];
+    postCommand(command);
+}
+
+SpeedProfile LineFollower::getProfile(Modes mode) {
+    return profiles[mode];
+}
+
+void LineFollower::setProfile(Modes mode, const SpeedProfile& profile) {
+    profiles[mode] = profile;
+    profilesAreDirty = true;
+    if (mode != selectedMode) return;
 
+    postProfile();
+#ifdef USE_BLUETOOTH
+    loadRemoteGains();
 #endif
 }
 
-void LineFollower::run() {
+#ifdef USE_BLUETOOTH
+void LineFollower::syncRemoteGains() {
+    SpeedProfile& profile = profiles[selectedMode];
+    bool hasChanged = false;
+    if (remoteSensorPid->kp != postedSensorGains[0] ||
+        remoteSensorPid->ki != postedSensorGains[1] ||
+        remoteSensorPid->kd != postedSensorGains[2]) {
+        profile.sensorGains[0] = postedSensorGains[0] = remoteSensorPid->kp;
+        profile.sensorGains[1] = postedSensorGains[1] = remoteSensorPid->ki;
+        profile.sensorGains[2] = postedSensorGains[2] = remoteSensorPid->kd;
+        hasChanged = true;
+    }
+    if (remoteGyroPid->kp != postedGyroGains[0] ||
+        remoteGyroPid->ki != postedGyroGains[1] ||
+        remoteGyroPid->kd != postedGyroGains[2]) {
+        profile.gyroGains[0] = postedGyroGains[0] = remoteGyroPid->kp;
+        profile.gyroGains[1] = postedGyroGains[1] = remoteGyroPid->ki;
+        profile.gyroGains[2] = postedGyroGains[2] = remoteGyroPid->kd;
+        hasChanged = true;
+    }
+    if (!hasChanged) return;
+
+    profilesAreDirty = true;
+    postProfile();
+}
+
+void LineFollower::loadRemoteGains() {
+    const SpeedProfile& profile = profiles[selectedMode];
+    remoteSensorPid->kp = postedSensorGains[0] = profile.sensorGains[0];
+    remoteSensorPid->ki = postedSensorGains[1] = profile.sensorGains[1];
+    remoteSensorPid->kd = postedSensorGains[2] = profile.sensorGains[2];
+    remoteGyroPid->kp = postedGyroGains[0] = profile.gyroGains[0];
+    remoteGyroPid->ki = postedGyroGains[1] = profile.gyroGains[1];
+    remoteGyroPid->kd = postedGyroGains[2] = profile.gyroGains[2];
+}
+
+void LineFollower::editProfileField(const char* edit) {
+    const char* separator = strchr(edit, '=');
+    const size_t nameLength = separator - edit;
+    char name[24];
+    // The reply never holds a '=', so it is not taken as another edit
+    char reply[40];
+
+    float* field = NULL;
+    if (nameLength < sizeof(name)) {
+        memcpy(name, edit, nameLength);
+        name[nameLength] = '\0';
+        field = ProfileStore::findField(profiles[selectedMode], name);
+    }
+    if (field == NULL) {
+        remotePid->setExtraInfo("unknown field");
+        return;
+    }
+
+    // A typo or nan would otherwise reach the motors on the next tick
+    char* end;
+    const float value = strtof(separator + 1, &end);
+    if (end == separator + 1 || *end != '\0' || !ProfileStore::isValidValue(name, value)) {
+        snprintf(reply, sizeof(reply), "%s: invalid value", name);
+        remotePid->setExtraInfo(reply);
+        return;
+    }
+
+    *field = value;
+    snprintf(reply, sizeof(reply), "%s: %.4f", name, *field);
+    remotePid->setExtraInfo(reply);
+
+    profilesAreDirty = true;
+    postProfile();
+    loadRemoteGains();
+}
+#endif
+
+void LineFollower::runHousekeeping() {
+    housekeepingTime = clock->now();
 #ifdef USE_BLUETOOTH
     remotePid->process();
-    if (remotePid->getExtraInfo()[0] == "a"[0]) {
+    const String extraInfo = remotePid->getExtraInfo();
+    if (extraInfo[0] == "a"[0]) {
         toggleMotorsAreActive();
         remotePid->setExtraInfo("b");
+    } else if (extraInfo.indexOf('=') > 0) {
+        editProfileField(extraInfo.c_str());
     }
+    syncRemoteGains();
+    telemetryBle.process(telemetry, uint32_t(housekeepingTime));
 #endif
-    // digitalWrite(led2Pin, motorsAreActive ? HIGH : LOW);
     updateButtons();
-    if (!gyroWasCalibrated) {
-        digitalWrite(led1Pin, HIGH);
-        digitalWrite(led2Pin, HIGH);
-        if (gyro->calibrate()) {
-            digitalWrite(led1Pin, LOW);
-            digitalWrite(led2Pin, LOW);
-            gyroWasCalibrated = true;
+    updateModeLeds();
+
+    // Flash writes stall both cores, profiles are only saved between runs
+    if (profilesAreDirty && !isRunning) {
+        profilesAreDirty = false;
+        if (!profileStore.save(profiles)) {
+#ifdef SERIAL_DEBUG
+            Serial.println("Failed to store the profiles");
+#endif
         }
     }
+}
 
-    sensorArray->updateSensorsArray();
-    sensorInput = calculateInput(sensorArray->sensorProcessed);
-    gyro->update();
+void LineFollower::run() {
+    PROFILE_BEGIN(PROFILE_TICK);
+    tickStartTime = clock->now();
+    processCommands();
 
-    updateMode();
+    if (!isCalibrated) {
+        runCalibration();
+    }
+
+    PROFILE_BEGIN(PROFILE_SENSORS);
+    sensorArray->updateSensorsArray(tickStartTime);
+    if (motorsAreActive) sensorArray->adaptCalibration();
+    sensorInput = calculateInput(sensorArray->processedMask);
+    processHelperEvents();
+    PROFILE_END(PROFILE_SENSORS);
+
+    PROFILE_BEGIN(PROFILE_GYRO);
+    gyro->update(tickStartTime);
+    PROFILE_END(PROFILE_GYRO);
 
-    rotSpeedTarget = calculateTargetRotSpeed(sensorTarget - sensorInput);
     rotSpeed = gyro->rotationSpeed;
 
-    motorOffset = calculateMotorOffset();
-    if (shouldStop) {
-        if (millis() - crossedFinishLine >= 200) {
-            motorsAreActive = false;
-        }
+    if (motorsAreActive) {
+        updateTrackMap();
     }
+
+    motorOffset = calculateMotorOffset();
+    updateRunState();
     /*
-    if (isOutOfLine && millis() - outOfLineStartingTime >= 800) {
+    if (isOutOfLine && tickStartTime - outOfLineStartingTime >= 800000) {
         motorsAreActive = false;
     }
     */
 
     if (motorsAreActive) {
-        if (doOnceStart) {
-            doOnceStart = false;
-        }
         const bool processedRightHelper = sensorArray->rightSensProcessed;
         if (!lastRightHelper && processedRightHelper) {
             lastRightHelper = processedRightHelper;
             // triggeredInterrupt(RIGHT);
         }
         lastRightHelper = processedRightHelper;
-        sensorPidResult = sensorPid->calculate(calculateSensorReadingError(sensorTarget - sensorInput));
-        gyroPidResult = gyroPid->calculate(rotSpeedTarget - rotSpeed);
+        PROFILE_BEGIN(PROFILE_PID);
+        updateSteering();
+        PROFILE_END(PROFILE_PID);
+
+        PROFILE_BEGIN(PROFILE_MOTORS);
         updateMotors();
+        PROFILE_END(PROFILE_MOTORS);
+        recordTick();
+        streamTick();
     } else {
         gyroPidResult = 0;
         sensorPidResult = 0;
         numberOfRightSignals = 0;
+        finishLap();
 
-        if (shouldStop) {
+        if (runState == BRAKED) {
             motors->brake();
         } else {
             motors->coast();
@@ -390,7 +918,8 @@ void LineFollower::run() {
         speedMultiplier = 1.0;
     }
     */
+    PROFILE_END(PROFILE_TICK);
+
     // printAll();
     // printAll2();
-    delay(5);
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ProfileStore.h"
+
+#include <Preferences.h>
+
+#include "esp_rom_crc.h"
+
+#define PROFILE_NAMESPACE "profiles"
+#define PROFILE_KEY "data"
+
+uint32_t ProfileStore::calculateCrc(const StoredProfiles& stored) {
+    // Everything but the CRC itself
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&stored), offsetof(StoredProfiles, crc));
+}
+
+bool ProfileStore::load(SpeedProfile profiles[N_OF_PROFILES]) {
+    Preferences preferences;
+    if (!preferences.begin(PROFILE_NAMESPACE, true)) return false;
+
+    StoredProfiles stored;
+    const bool sizeMatches = preferences.getBytesLength(PROFILE_KEY) == sizeof(stored);
+    const bool wasRead = sizeMatches && preferences.getBytes(PROFILE_KEY, &stored, sizeof(stored)) == sizeof(stored);
+    preferences.end();
+
+    if (!wasRead) return false;
+    if (stored.version != PROFILE_VERSION) return false;
+    if (stored.crc != calculateCrc(stored)) return false;
+
+    memcpy(profiles, stored.profiles, sizeof(stored.profiles));
+    return true;
+}
+
+bool ProfileStore::save(const SpeedProfile profiles[N_OF_PROFILES]) {
+    Preferences preferences;
+    if (!preferences.begin(PROFILE_NAMESPACE, false)) return false;
+
+    StoredProfiles stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.version = PROFILE_VERSION;
+    memcpy(stored.profiles, profiles, sizeof(stored.profiles));
+    stored.crc = calculateCrc(stored);
+
+    const bool wasWritten = preferences.putBytes(PROFILE_KEY, &stored, sizeof(stored)) == sizeof(stored);
+    preferences.end();
+    return wasWritten;
+}
+
+float* ProfileStore::findField(SpeedProfile& profile, const char* name) {
+    if (strcmp(name, "minOffset") == 0) return &profile.minMotorOffset;
+    if (strcmp(name, "maxOffset") == 0) return &profile.maxMotorOffset;
+    if (strcmp(name, "turbo") == 0) return &profile.turboFactor;
+    if (strcmp(name, "turboError") == 0) return &profile.turboMaxError;
+    if (strcmp(name, "errorGain") == 0) return &profile.errorGain;
+
+    // sensorKp, gyroKd, ...
+    const char* gainNames[3] = {"Kp", "Ki", "Kd"};
+    for (uint8_t i = 0; i < 3; i++) {
+        if (strncmp(name, "sensor", 6) == 0 && strcmp(name + 6, gainNames[i]) == 0) return &profile.sensorGains[i];
+        if (strncmp(name, "gyro", 4) == 0 && strcmp(name + 4, gainNames[i]) == 0) return &profile.gyroGains[i];
+    }
+
+    // breakpoint0 to breakpoint2, shape0 to shape3
+    const size_t length = strlen(name);
+    if (length == 0) return NULL;
+    const int index = name[length - 1] - '0';
+    if (length == 11 && strncmp(name, "breakpoint", 10) == 0 && index >= 0 && index < N_OF_ERROR_RANGES - 1) {
+        return &profile.errorBreakpoints[index];
+    }
+    if (length == 6 && strncmp(name, "shape", 5) == 0 && index >= 0 && index < N_OF_ERROR_RANGES) {
+        return &profile.errorShapeGains[index];
+    }
+    return NULL;
+}
+
+bool ProfileStore::isValidValue(const char* name, float value) {
+    if (!isfinite(value) || value < 0) return false;
+
+    if (strcmp(name, "minOffset") == 0 || strcmp(name, "maxOffset") == 0) return value <= 1;
+    if (strcmp(name, "turbo") == 0) return value <= PROFILE_MAX_TURBO;
+    if (strcmp(name, "turboError") == 0 || strncmp(name, "breakpoint", 10) == 0) return value <= N_OF_SENSORS - 1;
+    return value <= PROFILE_MAX_GAIN;
+}
@@ -0,0 +1,90 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+static const char* const STAGE_NAMES[NUMBER_OF_PROFILER_STAGES] = {
+    "tick",
+    "sensors",
+    "gyro",
+    "pid",
+    "motors"};
+
+uint32_t Profiler::startCycles[NUMBER_OF_PROFILER_STAGES];
+ProfilerStageStats Profiler::stats[NUMBER_OF_PROFILER_STAGES];
+SeqLock<ProfilerStageStats> Profiler::snapshots[NUMBER_OF_PROFILER_STAGES];
+std::atomic<bool> Profiler::shouldReset{true};
+
+void Profiler::add(ProfilerStage stage, uint32_t cycles) {
+    // The tick stage ends last, every other stage of this tick is already in
+    if (stage == PROFILE_TICK && shouldReset.load(std::memory_order_relaxed)) {
+        for (uint8_t i = 0; i < NUMBER_OF_PROFILER_STAGES; i++) {
+            memset(&stats[i], 0, sizeof(ProfilerStageStats));
+            stats[i].minCycles = UINT32_MAX;
+            snapshots[i].write(stats[i]);
+        }
+        shouldReset.store(false, std::memory_order_relaxed);
+    }
+
+    ProfilerStageStats& stageStats = stats[stage];
+    stageStats.count++;
+    stageStats.totalCycles += cycles;
+    if (cycles < stageStats.minCycles) stageStats.minCycles = cycles;
+    if (cycles > stageStats.maxCycles) stageStats.maxCycles = cycles;
+    stageStats.histogram[31 - __builtin_clz(cycles | 1)]++;
+    snapshots[stage].write(stageStats);
+}
+
+void Profiler::requestReset() {
+    shouldReset.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::report(Print& output) {
+    const float cyclesPerMicro = ESP.getCpuFreqMHz();
+
+    for (uint8_t stage = 0; stage < NUMBER_OF_PROFILER_STAGES; stage++) {
+        const ProfilerStageStats stageStats = snapshots[stage].read();
+        output.print(STAGE_NAMES[stage]);
+        output.print("\t");
+        output.print("n: ");
+        output.print(stageStats.count);
+        if (stageStats.count == 0) {
+            output.println();
+            continue;
+        }
+        output.print("\t");
+        output.print("min/mean/max us: ");
+        output.print(stageStats.minCycles / cyclesPerMicro);
+        output.print("/");
+        output.print(float(stageStats.totalCycles / stageStats.count) / cyclesPerMicro);
+        output.print("/");
+        output.print(stageStats.maxCycles / cyclesPerMicro);
+        output.print("\t");
+
+        // Only the buckets that were hit, as <lower bound in cycles>:<count>
+        output.print("hist: ");
+        for (uint8_t bucket = 0; bucket < PROFILER_NUMBER_OF_BUCKETS; bucket++) {
+            if (stageStats.histogram[bucket] == 0) continue;
+            output.print(1UL << bucket);
+            output.print(":");
+            output.print(stageStats.histogram[bucket]);
+            output.print(" ");
+        }
+        output.println();
+    }
+}
+
+#endif  // ENABLE_PROFILER
@@ -0,0 +1,71 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RunRecorder.h"
+
+#include "esp_rom_crc.h"
+
+bool RunRecorder::initialize() {
+    records = static_cast<RunRecord*>(ps_malloc(RUN_RECORDER_CAPACITY * sizeof(RunRecord)));
+    return records != NULL;
+}
+
+void RunRecorder::clear() {
+    if (isDumping.load(std::memory_order_acquire)) return;
+    numberOfRecords.store(0, std::memory_order_release);
+}
+
+void RunRecorder::record(const RunRecord& runRecord) {
+    if (records == NULL) return;
+
+    // Announced before isDumping is checked, so dump() either sees it or is seen
+    isRecording.store(true, std::memory_order_seq_cst);
+    if (!isDumping.load(std::memory_order_seq_cst)) {
+        const uint32_t index = numberOfRecords.load(std::memory_order_relaxed);
+        records[index % RUN_RECORDER_CAPACITY] = runRecord;
+        numberOfRecords.store(index + 1, std::memory_order_release);
+    }
+    isRecording.store(false, std::memory_order_release);
+}
+
+void RunRecorder::dump(Print& output) {
+    if (records == NULL) return;
+
+    isDumping.store(true, std::memory_order_seq_cst);
+    // Waits out a record() that started before the flag was set, it only copies one record
+    while (isRecording.load(std::memory_order_seq_cst)) {
+    }
+
+    const uint32_t totalRecords = numberOfRecords.load(std::memory_order_acquire);
+    const uint32_t storedRecords = totalRecords < RUN_RECORDER_CAPACITY ? totalRecords : RUN_RECORDER_CAPACITY;
+    const uint32_t overwrittenRecords = totalRecords - storedRecords;
+    const uint16_t version = RUN_RECORD_VERSION;
+    const uint16_t recordSize = sizeof(RunRecord);
+
+    output.write(reinterpret_cast<const uint8_t*>("VDRR"), 4);
+    output.write(reinterpret_cast<const uint8_t*>(&version), sizeof(version));
+    output.write(reinterpret_cast<const uint8_t*>(&recordSize), sizeof(recordSize));
+    output.write(reinterpret_cast<const uint8_t*>(&storedRecords), sizeof(storedRecords));
+    output.write(reinterpret_cast<const uint8_t*>(&overwrittenRecords), sizeof(overwrittenRecords));
+
+    uint32_t crc = 0;
+    for (uint32_t i = overwrittenRecords; i < totalRecords; i++) {
+        const uint8_t* recordBytes = reinterpret_cast<const uint8_t*>(&records[i % RUN_RECORDER_CAPACITY]);
+        crc = esp_rom_crc32_le(crc, recordBytes, sizeof(RunRecord));
+        output.write(recordBytes, sizeof(RunRecord));
+    }
+    output.write(reinterpret_cast<const uint8_t*>(&crc), sizeof(crc));
+
+    isDumping.store(false, std::memory_order_release);
+}
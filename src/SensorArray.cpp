@@ -13,6 +13,17 @@
 // limitations under the License.
 #include "SensorArray.h"
 
+#include "driver/adc.h"
+#include "soc/gpio_struct.h"
+
+// Bytes of each conversion in a DMA frame
+#define ADC_RESULT_BYTES SOC_ADC_DIGI_RESULT_BYTES
+#define ADC_DMA_FRAME_BYTES (ANALOG_CONVERSIONS_PER_DMA_FRAME * ADC_RESULT_BYTES)
+// Conversions averaged into a reading
+#define ADC_READING_BYTES (ANALOG_OVERSAMPLING * ADC_RESULT_BYTES)
+
+static_assert(ANALOG_OVERSAMPLING % ANALOG_CONVERSIONS_PER_DMA_FRAME == 0, "A reading must be whole DMA frames");
+
 SensorArray::SensorArray(uint8_t multiplexerIOPin,
                          uint8_t multiplexerS0Pin,
                          uint8_t multiplexerS1Pin,
@@ -34,10 +45,31 @@ SensorArray::SensorArray(uint8_t multiplexerIOPin,
     lineColor = colorOfTheLine;
     readsAnalog = useAnalogSensors;
 
+    resetCalibration();
+}
+
+void SensorArray::resetCalibration() {
     for (int i = 0; i < N_OF_SENSORS; i++) {
         minRead[i] = UINT16_MAX;
         maxRead[i] = 0;
+        sensorsThreshold[i] = 0;
     }
+    isAdaptationSeeded = false;
+    lowContrastMask = 0;
+}
+
+void SensorArray::getCalibration(uint16_t minReads[N_OF_SENSORS], uint16_t maxReads[N_OF_SENSORS], uint16_t thresholds[N_OF_SENSORS]) {
+    memcpy(minReads, minRead, sizeof(minRead));
+    memcpy(maxReads, maxRead, sizeof(maxRead));
+    memcpy(thresholds, sensorsThreshold, sizeof(sensorsThreshold));
+}
+
+void SensorArray::setCalibration(const uint16_t minReads[N_OF_SENSORS], const uint16_t maxReads[N_OF_SENSORS], const uint16_t thresholds[N_OF_SENSORS]) {
+    memcpy(minRead, minReads, sizeof(minRead));
+    memcpy(maxRead, maxReads, sizeof(maxRead));
+    memcpy(sensorsThreshold, thresholds, sizeof(sensorsThreshold));
+    isAdaptationSeeded = false;
+    lowContrastMask = 0;
 }
 
 void SensorArray::initialize() {
@@ -49,10 +81,151 @@ void SensorArray::initialize() {
     pinMode(_ledSelec2Pin, OUTPUT);
     pinMode(_leftHelperPin, INPUT);
     pinMode(_rightHelperPin, INPUT);
+
+#ifdef SERIAL_DEBUG
+    if (_mplxS0Pin >= 32 || _mplxS1Pin >= 32 || _mplxS2Pin >= 32) {
+        Serial.println("Multiplexer select pins must be below GPIO32");
+    }
+#endif
+
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        _mplxChannelMask[channel] = 0;
+        if (channel & 0b100) _mplxChannelMask[channel] |= 1UL << _mplxS0Pin;
+        if (channel & 0b010) _mplxChannelMask[channel] |= 1UL << _mplxS1Pin;
+        if (channel & 0b001) _mplxChannelMask[channel] |= 1UL << _mplxS2Pin;
+    }
+
+    // Starts from a known state, Y0
+    GPIO.out_w1tc = _mplxChannelMask[7];
+    _mplxCurrentMask = 0;
+
+    if (readsAnalog && !startAnalogSampler()) {
+#ifdef SERIAL_DEBUG
+        Serial.println("Failed to start the analog sampler");
+#endif
+    }
+}
+
+bool SensorArray::startAnalogSampler() {
+    const int8_t channel = digitalPinToAnalogChannel(_mplxIOPin);
+
+    // Only ADC1 can be used with the DMA
+    if (channel < 0 || channel >= SOC_ADC_CHANNEL_NUM(0)) return false;
+    _adcChannel = channel;
+
+    adc_digi_init_config_t initConfig = {};
+    initConfig.max_store_buf_size = 4 * ADC_READING_BYTES;
+    initConfig.conv_num_each_intr = ADC_DMA_FRAME_BYTES;
+    initConfig.adc1_chan_mask = 1UL << _adcChannel;
+    initConfig.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&initConfig) != ESP_OK) return false;
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;
+    pattern.channel = _adcChannel;
+    pattern.unit = 0;
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t digiConfig = {};
+    digiConfig.conv_limit_en = false;
+    digiConfig.conv_limit_num = 250;
+    digiConfig.pattern_num = 1;
+    digiConfig.adc_pattern = &pattern;
+    digiConfig.sample_freq_hz = ANALOG_SAMPLE_RATE_HZ;
+    digiConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    digiConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    if (adc_digi_controller_configure(&digiConfig) != ESP_OK) return false;
+
+    if (adc_digi_start() != ESP_OK) return false;
+
+    isSamplerRunning = xTaskCreatePinnedToCore(
+                           analogSamplerEntry,
+                           "analogSampler",
+                           ANALOG_SAMPLER_TASK_STACK_SIZE,
+                           this,
+                           ANALOG_SAMPLER_TASK_PRIORITY,
+                           NULL,
+                           ANALOG_SAMPLER_TASK_CORE) == pdPASS;
+    return isSamplerRunning;
+}
+
+void SensorArray::analogSamplerEntry(void* arg) {
+    static_cast<SensorArray*>(arg)->analogSamplerLoop();
+}
+
+void SensorArray::analogSamplerLoop() {
+    for (;;) {
+        // Scanned into a local frame, only the copy at the end is shared with the control task
+        SensorFrame frame;
+        for (uint8_t step = 0; step < N_OF_SENSORS; step++) {
+            const uint8_t sensorIndex = MPLX_GRAY_SCAN_ORDER[step];
+#ifndef LED_ALWAYS_ON
+            selectLedBank(sensorIndex);
+#endif
+            selectSensor(sensorIndex);
+            flushConversions();
+            frame.raw[sensorIndex] = readConversionFrame();
+        }
+        frame.sequence = ++_samplerSequence;
+        frame.timestamp = esp_timer_get_time();
+        _latestFrame.write(frame);
+    }
+}
+
+void SensorArray::flushConversions() {
+    uint8_t discarded[ADC_READING_BYTES];
+    uint32_t length = 0;
+
+    // Empties whatever the driver already buffered
+    while (adc_digi_read_bytes(discarded, sizeof(discarded), &length, 0) == ESP_OK) {
+    }
+
+    // Only the DMA frame being converted right now may have started before the switch
+    adc_digi_read_bytes(discarded, ADC_DMA_FRAME_BYTES, &length, ADC_MAX_DELAY);
+}
+
+uint16_t SensorArray::readConversionFrame() {
+    uint8_t buffer[ADC_READING_BYTES];
+    uint32_t length = 0;
+
+    // The driver may hand the DMA frames over one at a time
+    while (length < ADC_READING_BYTES) {
+        uint32_t frameLength = 0;
+        if (adc_digi_read_bytes(buffer + length, ADC_READING_BYTES - length, &frameLength, ADC_MAX_DELAY) != ESP_OK) {
+            return 0;
+        }
+        length += frameLength;
+    }
+
+    uint32_t total = 0;
+    uint16_t numberOfConversions = 0;
+    for (uint32_t i = 0; i + ADC_RESULT_BYTES <= length; i += ADC_RESULT_BYTES) {
+        const adc_digi_output_data_t* result = reinterpret_cast<adc_digi_output_data_t*>(&buffer[i]);
+        if (result->type2.channel != _adcChannel) continue;
+        total += result->type2.data;
+        numberOfConversions++;
+    }
+    return numberOfConversions ? total / numberOfConversions : 0;
 }
 
-void SensorArray::calibrateSensors() {
-    updateSensorsArray();
+void SensorArray::selectLedBank(uint8_t sensorIndex) {
+    // Even sensors use the first bank, odd sensors the second one
+    const bool isFirstBank = sensorIndex % 2 == 0;
+
+    // Sets the P-channel MOSFFET gate to LOW, turning it on
+    digitalWrite(_ledSelec1Pin, isFirstBank ? LOW : HIGH);
+    digitalWrite(_ledSelec2Pin, isFirstBank ? HIGH : LOW);
+}
+
+void SensorArray::copyLatestFrame() {
+    const SensorFrame frame = _latestFrame.read();
+    memcpy(sensorRaw, frame.raw, sizeof(sensorRaw));
+    frameSequence = frame.sequence;
+    frameTimestamp = frame.timestamp;
+}
+
+void SensorArray::calibrateSensors(int64_t tickTime) {
+    updateSensorsArray(tickTime);
     for (int i = 0; i < N_OF_SENSORS; i++) {
         if (sensorRaw[i] > maxRead[i]) {
             maxRead[i] = sensorRaw[i];
@@ -64,6 +237,88 @@ void SensorArray::calibrateSensors() {
     }
 }
 
+void SensorArray::adaptCalibration() {
+    if (!readsAnalog) return;
+
+    if (!isAdaptationSeeded) {
+        for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+            // Not calibrated
+            if (maxRead[i] <= minRead[i]) return;
+        }
+        for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+            darkLevel[i] = int32_t(maxRead[i]) << 8;
+            lightLevel[i] = int32_t(minRead[i]) << 8;
+        }
+        isAdaptationSeeded = true;
+    }
+
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        const int32_t reading = int32_t(sensorRaw[i]) << 8;
+
+        // Higher readings are darker
+        if (sensorRaw[i] > sensorsThreshold[i]) {
+            darkLevel[i] += (reading - darkLevel[i]) >> SENSOR_ADAPTATION_SHIFT;
+            lightLevel[i] += (reading - lightLevel[i]) >> SENSOR_LEVEL_DECAY_SHIFT;
+        } else {
+            lightLevel[i] += (reading - lightLevel[i]) >> SENSOR_ADAPTATION_SHIFT;
+            darkLevel[i] += (reading - darkLevel[i]) >> SENSOR_LEVEL_DECAY_SHIFT;
+        }
+
+        if ((darkLevel[i] - lightLevel[i]) >> 8 < SENSOR_MIN_CONTRAST) {
+            lowContrastMask |= 1 << i;
+            continue;
+        }
+        lowContrastMask &= ~(1 << i);
+
+        minRead[i] = lightLevel[i] >> 8;
+        maxRead[i] = darkLevel[i] >> 8;
+        sensorsThreshold[i] = (minRead[i] + maxRead[i]) / 2;
+    }
+}
+
+bool SensorArray::calculateCentroid(float& position) {
+    int32_t weight[N_OF_SENSORS];
+    uint8_t strongestSensor = 0;
+
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        const int32_t range = int32_t(maxRead[i]) - minRead[i];
+        if (range <= 0) {
+            // Not calibrated
+            weight[i] = 0;
+            continue;
+        }
+        int32_t level = int32_t(sensorRaw[i]) - minRead[i];
+        if (level < 0) level = 0;
+        if (level > range) level = range;
+
+        // Q8, higher readings are darker
+        int32_t lineLevel = (level << 8) / range;
+        if (lineColor == WHITE) lineLevel = 256 - lineLevel;
+
+        weight[i] = lineLevel > CENTROID_NOISE_FLOOR ? lineLevel - CENTROID_NOISE_FLOOR : 0;
+        if (weight[i] > weight[strongestSensor]) strongestSensor = i;
+    }
+
+    // Grows the group to both sides while the sensors still see the line
+    uint8_t groupStart = strongestSensor;
+    uint8_t groupEnd = strongestSensor;
+    while (groupStart > 0 && weight[groupStart - 1] > 0) groupStart--;
+    while (groupEnd < N_OF_SENSORS - 1 && weight[groupEnd + 1] > 0) groupEnd++;
+
+    int32_t totalWeight = 0;
+    int32_t weightedSum = 0;
+    for (uint8_t i = groupStart; i <= groupEnd; i++) {
+        totalWeight += weight[i];
+        weightedSum += weight[i] * i;
+    }
+    if (totalWeight < CENTROID_MIN_WEIGHT) return false;
+
+    // Q8 position
+    const int32_t centroid = (weightedSum << 8) / totalWeight;
+    position = float(centroid) / 256.0f;
+    return true;
+}
+
 void SensorArray::printAllRaw() {
 #ifdef SERIAL_DEBUG
     Serial.print(leftSensRaw);
@@ -84,7 +339,7 @@ void SensorArray::printAllProcessed() {
     Serial.print("---");
 
     for (uint16_t i = 0; i < N_OF_SENSORS; i++) {
-        Serial.print(sensorProcessed[i]);
+        Serial.print(processedMask & (1 << i) ? 1 : 0);
         Serial.print(",");
     }
 
@@ -94,88 +349,96 @@ void SensorArray::printAllProcessed() {
 }
 
 void SensorArray::selectSensor(uint8_t sensorIndex) {
-    /*
-        S0  S1  S2  Channel
-        L   L   L   Y0 = S7
-        L   L   H   Y1 = S6
-        L   H   L   Y2 = S5
-        L   H   H   Y3 = S8
-        H   L   L   Y4 = S4
-        H   L   H   Y5 = S1
-        H   H   L   Y6 = S3
-        H   H   H   Y7 = S2
-    */
-
-    switch (sensorIndex) {
-        case 6:
-            digitalWrite(_mplxS0Pin, LOW);
-            digitalWrite(_mplxS1Pin, LOW);
-            digitalWrite(_mplxS2Pin, LOW);
-            break;
-        case 5:
-            digitalWrite(_mplxS0Pin, LOW);
-            digitalWrite(_mplxS1Pin, LOW);
-            digitalWrite(_mplxS2Pin, HIGH);
-            break;
-        case 4:
-            digitalWrite(_mplxS0Pin, LOW);
-            digitalWrite(_mplxS1Pin, HIGH);
-            digitalWrite(_mplxS2Pin, LOW);
-            break;
-        case 7:
-            digitalWrite(_mplxS0Pin, LOW);
-            digitalWrite(_mplxS1Pin, HIGH);
-            digitalWrite(_mplxS2Pin, HIGH);
-            break;
-        case 3:
-            digitalWrite(_mplxS0Pin, HIGH);
-            digitalWrite(_mplxS1Pin, LOW);
-            digitalWrite(_mplxS2Pin, LOW);
-            break;
-        case 0:
-            digitalWrite(_mplxS0Pin, HIGH);
-            digitalWrite(_mplxS1Pin, LOW);
-            digitalWrite(_mplxS2Pin, HIGH);
-            break;
-        case 2:
-            digitalWrite(_mplxS0Pin, HIGH);
-            digitalWrite(_mplxS1Pin, HIGH);
-            digitalWrite(_mplxS2Pin, LOW);
-            break;
-        case 1:
-            digitalWrite(_mplxS0Pin, HIGH);
-            digitalWrite(_mplxS1Pin, HIGH);
-            digitalWrite(_mplxS2Pin, HIGH);
-            break;
-
-        default:
-            digitalWrite(_mplxS0Pin, LOW);
-            digitalWrite(_mplxS1Pin, LOW);
-            digitalWrite(_mplxS2Pin, LOW);
-            break;
+    const uint32_t targetMask = _mplxChannelMask[MPLX_SENSOR_CHANNEL[sensorIndex]];
+    const uint32_t pinsToSet = targetMask & ~_mplxCurrentMask;
+    const uint32_t pinsToClear = _mplxCurrentMask & ~targetMask;
+
+    if (pinsToSet) GPIO.out_w1ts = pinsToSet;
+    if (pinsToClear) GPIO.out_w1tc = pinsToClear;
+    _mplxCurrentMask = targetMask;
+
+#if MPLX_SETTLE_TIME_US > 0
+    delayMicroseconds(MPLX_SETTLE_TIME_US);
+#endif
+}
+
+#ifdef SENSOR_SCAN_BENCHMARK
+void SensorArray::selectSensorDigitalWrite(uint8_t sensorIndex) {
+    const uint8_t channel = MPLX_SENSOR_CHANNEL[sensorIndex];
+    digitalWrite(_mplxS0Pin, channel & 0b100 ? HIGH : LOW);
+    digitalWrite(_mplxS1Pin, channel & 0b010 ? HIGH : LOW);
+    digitalWrite(_mplxS2Pin, channel & 0b001 ? HIGH : LOW);
+}
+
+void SensorArray::benchmarkScan(uint16_t iterations) {
+    uint32_t start = ESP.getCycleCount();
+    for (uint16_t i = 0; i < iterations; i++) {
+        for (uint8_t sensorIndex = 0; sensorIndex < N_OF_SENSORS; sensorIndex++) {
+            selectSensorDigitalWrite(sensorIndex);
+        }
     }
+    const uint32_t digitalWriteCycles = (ESP.getCycleCount() - start) / iterations;
+
+    start = ESP.getCycleCount();
+    for (uint16_t i = 0; i < iterations; i++) {
+        for (uint8_t step = 0; step < N_OF_SENSORS; step++) {
+            selectSensor(MPLX_GRAY_SCAN_ORDER[step]);
+        }
+    }
+    const uint32_t registerCycles = (ESP.getCycleCount() - start) / iterations;
+
+    start = ESP.getCycleCount();
+    for (uint16_t i = 0; i < iterations; i++) {
+        updateSensorsArray(esp_timer_get_time());
+    }
+    const uint32_t fullScanCycles = (ESP.getCycleCount() - start) / iterations;
+
+#ifdef SERIAL_DEBUG
+    // Settle time is included in the register numbers
+    Serial.print("Cycles per scan, digitalWrite select: ");
+    Serial.print(digitalWriteCycles);
+    Serial.print("\t");
+    Serial.print("register select: ");
+    Serial.print(registerCycles);
+    Serial.print("\t");
+    Serial.print("full update: ");
+    Serial.print(fullScanCycles);
+    Serial.print(" (");
+    Serial.print(float(fullScanCycles) / ESP.getCpuFreqMHz());
+    Serial.println("us)");
+#endif
 }
+#endif
 
 uint16_t SensorArray::readSensorAt(uint8_t sensorIndex) {
     selectSensor(sensorIndex);
     return readsAnalog ? analogRead(_mplxIOPin) : digitalRead(_mplxIOPin);
 }
 
-void SensorArray::updateSensorsArray() {
+void SensorArray::updateSensorsArray(int64_t tickTime) {
     leftSensRaw = digitalRead(_leftHelperPin);
     rightSensRaw = digitalRead(_rightHelperPin);
 
     leftSensProcessed = lineColor == BLACK ? leftSensRaw : !leftSensRaw;
     rightSensProcessed = lineColor == BLACK ? rightSensRaw : !rightSensRaw;
 
-#ifndef LED_ALWAYS_ON
+    if (isSamplerRunning) {
+        copyLatestFrame();
+        processReadings();
+        return;
+    }
+
+#ifdef LED_ALWAYS_ON
+    for (uint8_t step = 0; step < N_OF_SENSORS; step++) {
+        const uint8_t sensorIndex = MPLX_GRAY_SCAN_ORDER[step];
+        sensorRaw[sensorIndex] = readSensorAt(sensorIndex);
+    }
+#else
     // Sets the P-channel MOSFFET gate to LOW, turning it on
-    digitalWrite(ledSelec1Pin, LOW);
+    digitalWrite(_ledSelec1Pin, LOW);
 
     // Sets the P-channel MOSFFET gate to HIGH, turning it off
-    digitalWrite(ledSelec2Pin, HIGH);
-
-#endif
+    digitalWrite(_ledSelec2Pin, HIGH);
 
     sensorRaw[0] = readSensorAt(0);
 
@@ -185,12 +448,9 @@ void SensorArray::updateSensorsArray() {
 
     sensorRaw[6] = readSensorAt(6);
 
-#ifndef LED_ALWAYS_ON
-    digitalWrite(ledSelec1Pin, HIGH);
+    digitalWrite(_ledSelec1Pin, HIGH);
 
-    digitalWrite(ledSelec2Pin, LOW);
-
-#endif
+    digitalWrite(_ledSelec2Pin, LOW);
 
     sensorRaw[1] = readSensorAt(1);
 
@@ -199,44 +459,19 @@ void SensorArray::updateSensorsArray() {
     sensorRaw[5] = readSensorAt(5);
 
     sensorRaw[7] = readSensorAt(7);
+#endif
 
+    frameTimestamp = tickTime;
     processReadings();
 }
 
 void SensorArray::processReadings() {
-    uint8_t lineStartsAt = 0;
-    uint8_t lineEndsAt = N_OF_SENSORS - 1;
-
+    uint8_t mask = 0;
     for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
-        if (!readsAnalog) {
-            if (sensorRaw[i]) {
-                sensorProcessed[i] = lineColor == BLACK ? true : false;
-            } else {
-                sensorProcessed[i] = lineColor == BLACK ? false : true;
-            }
-        } else {
-            if (sensorRaw[i] > sensorsThreshold[i]) {
-                sensorProcessed[i] = lineColor == BLACK ? true : false;
-            } else {
-                sensorProcessed[i] = lineColor == BLACK ? false : true;
-            }
-        }
-
-        if (i > 0) {
-            if (sensorProcessed[i] && !sensorProcessed[i - 1]) {
-                lineStartsAt = i;
-            }
-        }
-
-        // Checking for end of line
-        if (i < N_OF_SENSORS) {
-            if (!sensorProcessed[i] && sensorProcessed[i - 1]) {
-                lineEndsAt = i;
-            }
-        }
-    }
-    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
-        if (i < lineStartsAt || i > lineEndsAt)
-            sensorProcessed[i] = 0;
+        const bool isDark = readsAnalog ? sensorRaw[i] > sensorsThreshold[i] : sensorRaw[i] != 0;
+        if (isDark == (lineColor == BLACK)) mask |= 1 << i;
     }
+
+    // Drops every sensor outside the line segment
+    processedMask = SENSOR_PATTERNS[mask].filtered;
 }
\ No newline at end of file
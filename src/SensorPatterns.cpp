@@ -0,0 +1,121 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SensorPatterns.h"
+
+/*
+    Compile time proof that the lookup tables give the same results as the
+    per-sensor loops they replaced, for every possible pattern
+*/
+
+namespace {
+
+struct LoopResult {
+    bool sensorProcessed[N_OF_SENSORS];
+    uint8_t numberOfActiveSensors;
+    float total;
+};
+
+// SensorArray::processReadings followed by LineFollower::calculateInput, as they were
+constexpr LoopResult runOriginalLoops(uint8_t mask) {
+    LoopResult result{};
+    bool* sensorProcessed = result.sensorProcessed;
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        sensorProcessed[i] = mask & (1 << i);
+    }
+
+    uint8_t lineStartsAt = 0;
+    uint8_t lineEndsAt = N_OF_SENSORS - 1;
+
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        if (i > 0) {
+            if (sensorProcessed[i] && !sensorProcessed[i - 1]) {
+                lineStartsAt = i;
+            }
+        }
+
+        // The loop read sensorProcessed[-1] for the first sensor, the byte
+        // before the array, that is always zero with digital sensors
+        if (i > 0) {
+            if (!sensorProcessed[i] && sensorProcessed[i - 1]) {
+                lineEndsAt = i;
+            }
+        }
+    }
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        if (i < lineStartsAt || i > lineEndsAt)
+            sensorProcessed[i] = 0;
+    }
+
+    float total = 0.0f;
+    uint8_t numberOfActiveSensors = 0;
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        if (sensorProcessed[i]) {
+            total += i;
+            numberOfActiveSensors++;
+        }
+    }
+    result.numberOfActiveSensors = numberOfActiveSensors;
+    result.total = total;
+    return result;
+}
+
+constexpr bool patternMatchesLoops(uint8_t mask) {
+    const LoopResult loops = runOriginalLoops(mask);
+    const SensorPattern& pattern = SENSOR_PATTERNS[mask];
+
+    uint8_t packed = 0;
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        if (loops.sensorProcessed[i]) packed |= 1 << i;
+    }
+    if (pattern.filtered != packed) return false;
+    if (pattern.activeSensors != loops.numberOfActiveSensors) return false;
+    if (pattern.isCrossing != (loops.numberOfActiveSensors >= 6)) return false;
+
+    if (loops.numberOfActiveSensors > 0) {
+        if (pattern.position != loops.total / float(loops.numberOfActiveSensors)) return false;
+
+        // The segment bounds hold every active sensor and nothing else
+        for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+            const bool isInSegment = i >= pattern.segmentStart && i <= pattern.segmentEnd;
+            if (loops.sensorProcessed[i] != isInSegment) return false;
+        }
+    }
+
+    const SensorPattern& filteredPattern = SENSOR_PATTERNS[pattern.filtered];
+    return filteredPattern.filtered == pattern.filtered &&
+           filteredPattern.activeSensors == pattern.activeSensors &&
+           filteredPattern.segmentStart == pattern.segmentStart &&
+           filteredPattern.segmentEnd == pattern.segmentEnd &&
+           filteredPattern.isCrossing == pattern.isCrossing &&
+           filteredPattern.position == pattern.position;
+}
+
+constexpr bool allPatternsMatchLoops() {
+    for (uint16_t mask = 0; mask < 256; mask++) {
+        if (!patternMatchesLoops(mask)) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+static_assert(allPatternsMatchLoops(), "SENSOR_PATTERNS differs from the sensor loops");
+
+// A few patterns spelled out, bit 0 is the leftmost sensor
+static_assert(SENSOR_PATTERNS[0b00011000].position == 3.5f, "Centered line");
+static_assert(SENSOR_PATTERNS[0b00000001].position == 0.0f, "Line under the first sensor");
+static_assert(SENSOR_PATTERNS[0b00111111].isCrossing, "Crossing");
+static_assert(SENSOR_PATTERNS[0b01100011].filtered == 0b01100000, "Stray sensors are dropped");
+static_assert(SENSOR_PATTERNS[0].activeSensors == 0, "No line");
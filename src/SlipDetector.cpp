@@ -0,0 +1,60 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SlipDetector.h"
+
+SlipDetector::SlipDetector() {
+    alpha = 1.0f / (CONTROL_LOOP_RATE_HZ * SLIP_TIME_CONSTANT_S);
+    if (alpha > 1) alpha = 1;
+}
+
+void SlipDetector::reset() {
+    expectedRotSpeed = 0;
+    residual = 0;
+    ticksOverThreshold = 0;
+    isSlipping = false;
+    slipEvents.store(0, std::memory_order_relaxed);
+}
+
+bool SlipDetector::update(float outputDifference, float measuredRotSpeed) {
+    expectedRotSpeed += alpha * (SLIP_YAW_GAIN * outputDifference - expectedRotSpeed);
+    residual = expectedRotSpeed - measuredRotSpeed;
+
+    const float absResidual = abs(residual);
+    const float threshold = SLIP_MIN_RESIDUAL + SLIP_RELATIVE_RESIDUAL * abs(expectedRotSpeed);
+
+    if (!isSlipping) {
+        ticksOverThreshold = absResidual > threshold ? ticksOverThreshold + 1 : 0;
+        if (ticksOverThreshold >= SLIP_CONFIRM_TICKS) {
+            isSlipping = true;
+            slipEvents.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else if (absResidual < threshold / 2) {
+        isSlipping = false;
+        ticksOverThreshold = 0;
+    }
+    return isSlipping;
+}
+
+bool SlipDetector::getIsSlipping() {
+    return isSlipping;
+}
+
+float SlipDetector::getResidual() {
+    return residual;
+}
+
+uint32_t SlipDetector::getSlipEvents() {
+    return slipEvents.load(std::memory_order_relaxed);
+}
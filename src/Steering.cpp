@@ -0,0 +1,228 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Steering.h"
+
+float shapeLineError(float error, const SpeedProfile& profile) {
+    const float absError = abs(error);
+    for (uint8_t i = 0; i < N_OF_ERROR_RANGES - 1; i++) {
+        if (absError <= profile.errorBreakpoints[i]) return error * profile.errorShapeGains[i];
+    }
+    return error * profile.errorShapeGains[N_OF_ERROR_RANGES - 1];
+}
+
+void KalmanEstimator::reset() {
+    lineEstimator.reset();
+}
+
+LineEstimate KalmanEstimator::update(const SteeringInput& input) {
+    lineEstimator.predict(input.dt, input.speed, input.angularVelocity);
+    if (input.seesLine) lineEstimator.correct(input.lineError * SENSOR_PITCH_M);
+
+    return LineEstimate{lineEstimator.getOffset() / SENSOR_PITCH_M, lineEstimator.getHeading(), true};
+}
+
+CascadedPidController::CascadedPidController(PIDestal& sensorPidRef, PIDestal& gyroPidRef) {
+    sensorPid = &sensorPidRef;
+    gyroPid = &gyroPidRef;
+}
+
+void CascadedPidController::applyProfile(const SpeedProfile& newProfile) {
+    profile = newProfile;
+    sensorPid->kp = profile.sensorGains[0];
+    sensorPid->ki = profile.sensorGains[1];
+    sensorPid->kd = profile.sensorGains[2];
+    gyroPid->kp = profile.gyroGains[0];
+    gyroPid->ki = profile.gyroGains[1];
+    gyroPid->kd = profile.gyroGains[2];
+}
+
+void CascadedPidController::update(const LineEstimate& estimate, const SteeringInput& input, SteeringOutput& output) {
+    // Both PIDs run every tick so neither jumps when the other hands over
+    output.rotSpeedTarget = input.lineError * 70;
+    output.sensorPidResult = sensorPid->calculate(shapeLineError(estimate.error, profile));
+    output.gyroPidResult = gyroPid->calculate(output.rotSpeedTarget - input.rotSpeed);
+
+    output.isGyroSteering = !estimate.isValid;
+    if (output.isGyroSteering) {
+        output.steering = output.gyroPidResult * profile.errorGain;
+    } else {
+        output.steering = output.sensorPidResult * 0.1;
+    }
+}
+
+PurePursuitController::PurePursuitController(PIDestal& sensorPidRef, PIDestal& gyroPidRef) {
+    gyroPid = &gyroPidRef;
+}
+
+void PurePursuitController::applyProfile(const SpeedProfile& profile) {
+    errorGain = profile.errorGain;
+    gyroPid->kp = profile.gyroGains[0];
+    gyroPid->ki = profile.gyroGains[1];
+    gyroPid->kd = profile.gyroGains[2];
+}
+
+void PurePursuitController::update(const LineEstimate& estimate, const SteeringInput& input, SteeringOutput& output) {
+    // The arc from the wheel axis through the line under the bar
+    const float lateral = estimate.error * SENSOR_PITCH_M;
+    const float curvature = 2 * lateral / (SENSOR_BAR_DISTANCE_M * SENSOR_BAR_DISTANCE_M + lateral * lateral);
+
+    // Still standing, the robot must turn onto the arc before it can follow it
+    const float speed = input.speed > PURE_PURSUIT_MIN_SPEED_M_S ? input.speed : PURE_PURSUIT_MIN_SPEED_M_S;
+    const float angularVelocity = speed * curvature;
+
+    output.rotSpeedTarget = angularVelocity * ROT_SPEED_PER_RAD_S;
+    output.gyroPidResult = gyroPid->calculate(output.rotSpeedTarget - input.rotSpeed);
+    output.sensorPidResult = 0;
+    output.isGyroSteering = true;
+
+    // Half the wheel speed difference of the arc
+    const float feedForward = angularVelocity * WHEEL_TRACK_M / 2 / MAX_WHEEL_SPEED_M_S;
+    output.steering = feedForward + output.gyroPidResult * errorGain;
+}
+
+void StateFeedbackController::applyProfile(const SpeedProfile& newProfile) {
+    profile = newProfile;
+}
+
+void StateFeedbackController::update(const LineEstimate& estimate, const SteeringInput& input, SteeringOutput& output) {
+    // How much the offset moves in a tick at this heading, in sensor pitches
+    const float errorChange = input.speed * estimate.heading / SENSOR_PITCH_M * input.dt;
+
+    output.sensorPidResult = profile.sensorGains[0] * shapeLineError(estimate.error, profile) +
+                             profile.sensorGains[2] * errorChange;
+    output.gyroPidResult = 0;
+    output.rotSpeedTarget = 0;
+    output.isGyroSteering = false;
+    output.steering = output.sensorPidResult * 0.1;
+}
+
+void FilteredPidController::applyProfile(const SpeedProfile& newProfile) {
+    profile = newProfile;
+    sensorPid.setGains(profile.sensorGains);
+    gyroPid.setGains(profile.gyroGains);
+}
+
+void FilteredPidController::reset() {
+    sensorPid.reset();
+    gyroPid.reset();
+}
+
+void FilteredPidController::update(const LineEstimate& estimate, const SteeringInput& input, SteeringOutput& output) {
+    // Only the output that steered last tick was saturated
+    const bool isSensorSaturated = output.isSaturated && !output.isGyroSteering;
+    const bool isGyroSaturated = output.isSaturated && output.isGyroSteering;
+
+    // The line position is the measurement, the target stays at the center
+    output.rotSpeedTarget = input.lineError * 70;
+    output.sensorPidResult = sensorPid.calculate(shapeLineError(estimate.error, profile), -estimate.error, input.dt, isSensorSaturated);
+    output.gyroPidResult = gyroPid.calculate(output.rotSpeedTarget - input.rotSpeed, input.rotSpeed, input.dt, isGyroSaturated);
+
+    output.isGyroSteering = !estimate.isValid;
+    if (output.isGyroSteering) {
+        output.steering = output.gyroPidResult * profile.errorGain;
+    } else {
+        output.steering = output.sensorPidResult * 0.1;
+    }
+}
+
+bool ClampingMixer::mix(float forwardOutput, float steering, float clamp, float& leftOutput, float& rightOutput) {
+    leftOutput = forwardOutput - steering;
+    rightOutput = forwardOutput + steering;
+    const bool isClamped = abs(leftOutput) > clamp || abs(rightOutput) > clamp;
+
+    if (leftOutput > clamp) leftOutput = clamp;
+    if (leftOutput < -clamp) leftOutput = -clamp;
+    if (rightOutput > clamp) rightOutput = clamp;
+    if (rightOutput < -clamp) rightOutput = -clamp;
+    return isClamped;
+}
+
+bool SteeringFirstMixer::mix(float forwardOutput, float steering, float clamp, float& leftOutput, float& rightOutput) {
+    // Room left for the forward output once the steering fits
+    const float headroom = clamp - abs(steering);
+    const float limitedForward = headroom > 0 ? constrain(forwardOutput, -headroom, headroom) : 0;
+    return ClampingMixer::mix(limitedForward, steering, clamp, leftOutput, rightOutput);
+}
+
+namespace {
+
+#define STEERING_BENCHMARK_INPUTS 256
+
+// Keeps the compiler from dropping the outputs
+volatile float benchmarkSink;
+
+// The line sweeps from edge to edge and a bit beyond, where it is lost
+void makeBenchmarkInputs(SteeringInput inputs[STEERING_BENCHMARK_INPUTS]) {
+    const float center = (N_OF_SENSORS - 1) / 2.0f;
+    for (uint16_t i = 0; i < STEERING_BENCHMARK_INPUTS; i++) {
+        const float phase = 2 * PI * i / STEERING_BENCHMARK_INPUTS;
+        const float position = center + (center + 1) * sinf(phase);
+
+        SteeringInput& input = inputs[i];
+        input.seesLine = position >= 0 && position <= N_OF_SENSORS - 1;
+        input.lineError = center - constrain(position, 0.0f, float(N_OF_SENSORS - 1));
+        input.rotSpeed = 40 * cosf(phase);
+        input.angularVelocity = input.rotSpeed / ROT_SPEED_PER_RAD_S;
+        input.speed = 1.5f;
+        input.dt = 1.0f / CONTROL_LOOP_RATE_HZ;
+    }
+}
+
+// Cycles of one update and mix
+template <typename SteeringType>
+float measureSteering(const SteeringInput inputs[STEERING_BENCHMARK_INPUTS], uint16_t iterations) {
+    PIDestal sensorPid(SENSOR_PID_KP, SENSOR_PID_KI, SENSOR_PID_KD);
+    PIDestal gyroPid(GYRO_PID_KP, GYRO_PID_KI, GYRO_PID_KD);
+    SteeringType steering(sensorPid, gyroPid);
+    steering.applyProfile(DEFAULT_PROFILES[1]);
+
+    float leftOutput, rightOutput;
+    const uint32_t start = ESP.getCycleCount();
+    for (uint16_t i = 0; i < iterations; i++) {
+        for (uint16_t j = 0; j < STEERING_BENCHMARK_INPUTS; j++) {
+            steering.update(inputs[j]);
+            steering.mix(0.8f, 1.0f, leftOutput, rightOutput);
+            benchmarkSink = leftOutput + rightOutput;
+        }
+    }
+    const uint32_t cycles = ESP.getCycleCount() - start;
+    return float(cycles) / (uint32_t(iterations) * STEERING_BENCHMARK_INPUTS);
+}
+
+template <typename SteeringType>
+void printSteeringCycles(const char* name, const SteeringInput inputs[STEERING_BENCHMARK_INPUTS], uint16_t iterations) {
+    const float cycles = measureSteering<SteeringType>(inputs, iterations);
+#ifdef SERIAL_DEBUG
+    Serial.print(name);
+    Serial.print(": ");
+    Serial.print(cycles, 1);
+    Serial.println(" cycles per tick");
+#endif
+}
+
+}  // namespace
+
+void benchmarkSteering(uint16_t iterations) {
+    static SteeringInput inputs[STEERING_BENCHMARK_INPUTS];
+    makeBenchmarkInputs(inputs);
+
+    printSteeringCycles<Steering<BarEstimator, CascadedPidController, ClampingMixer>>("bar, cascaded PID, clamping", inputs, iterations);
+    printSteeringCycles<Steering<KalmanEstimator, CascadedPidController, ClampingMixer>>("kalman, cascaded PID, clamping", inputs, iterations);
+    printSteeringCycles<Steering<BarEstimator, PurePursuitController, ClampingMixer>>("bar, pure pursuit, clamping", inputs, iterations);
+    printSteeringCycles<Steering<KalmanEstimator, PurePursuitController, ClampingMixer>>("kalman, pure pursuit, clamping", inputs, iterations);
+    printSteeringCycles<Steering<KalmanEstimator, StateFeedbackController, ClampingMixer>>("kalman, state feedback, clamping", inputs, iterations);
+    printSteeringCycles<Steering<BarEstimator, FilteredPidController, ClampingMixer>>("bar, filtered PID, clamping", inputs, iterations);
+    printSteeringCycles<Steering<BarEstimator, CascadedPidController, SteeringFirstMixer>>("bar, cascaded PID, steering first", inputs, iterations);
+}
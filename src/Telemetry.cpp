@@ -0,0 +1,129 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Telemetry.h"
+
+int16_t quantizeTelemetry(float value, uint8_t channel) {
+    const float scaled = value * TELEMETRY_CHANNEL_SCALE[channel];
+    if (!(scaled > INT16_MIN)) return scaled > 0 ? INT16_MAX : INT16_MIN;
+    if (scaled >= INT16_MAX) return INT16_MAX;
+    return int16_t(lroundf(scaled));
+}
+
+void TelemetryEncoder::begin(uint8_t* packetBuffer, uint16_t packetCapacity, uint16_t sequence) {
+    buffer = packetBuffer;
+    capacity = packetCapacity;
+    count = 0;
+
+    buffer[0] = TELEMETRY_PACKET_VERSION;
+    buffer[1] = sequence & 0xFF;
+    buffer[2] = sequence >> 8;
+    buffer[3] = 0;
+    size = TELEMETRY_HEADER_SIZE;
+}
+
+uint8_t TelemetryEncoder::writeVarint(uint8_t* output, uint32_t value) {
+    uint8_t length = 0;
+    while (value >= 0x80) {
+        output[length++] = uint8_t(value) | 0x80;
+        value >>= 7;
+    }
+    output[length++] = uint8_t(value);
+    return length;
+}
+
+bool TelemetryEncoder::add(const TelemetrySample& sample) {
+    if (count == UINT8_MAX) return false;
+
+    // Largest sample, a full timestamp varint and three bytes per channel
+    uint8_t encoded[5 + 3 * TELEMETRY_N_OF_CHANNELS];
+    uint8_t length = 0;
+
+    if (count == 0) {
+        for (uint8_t i = 0; i < 4; i++) encoded[length++] = uint8_t(sample.timestamp >> (8 * i));
+        for (uint8_t i = 0; i < TELEMETRY_N_OF_CHANNELS; i++) {
+            encoded[length++] = uint16_t(sample.channels[i]) & 0xFF;
+            encoded[length++] = uint16_t(sample.channels[i]) >> 8;
+        }
+        firstSample = sample;
+    } else {
+        length += writeVarint(encoded + length, sample.timestamp - lastSample.timestamp);
+        for (uint8_t i = 0; i < TELEMETRY_N_OF_CHANNELS; i++) {
+            const int32_t delta = int32_t(sample.channels[i]) - lastSample.channels[i];
+            const uint32_t zigzag = (uint32_t(delta) << 1) ^ uint32_t(delta >> 31);
+            length += writeVarint(encoded + length, zigzag);
+        }
+    }
+
+    if (size + length > capacity) return false;
+
+    memcpy(buffer + size, encoded, length);
+    size += length;
+    count++;
+    lastSample = sample;
+    return true;
+}
+
+uint16_t TelemetryEncoder::finish() {
+    buffer[3] = count;
+    return size;
+}
+
+uint8_t TelemetryEncoder::getCount() {
+    return count;
+}
+
+uint32_t TelemetryEncoder::getFirstTimestamp() {
+    return firstSample.timestamp;
+}
+
+void TelemetryStream::push(const TelemetrySample& sample) {
+    if (!samples.push(sample)) droppedSamples.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint16_t TelemetryStream::readPacket(uint8_t* buffer, uint16_t capacity, uint32_t timeNow) {
+    if (capacity > TELEMETRY_MAX_PACKET_SIZE) capacity = TELEMETRY_MAX_PACKET_SIZE;
+
+    if (packetCapacity == 0) {
+        packetCapacity = capacity;
+        encoder.begin(packet, packetCapacity, packetSequence);
+    }
+
+    bool isFull = false;
+    for (;;) {
+        if (!hasPendingSample && !samples.pop(pendingSample)) break;
+        hasPendingSample = true;
+        if (!encoder.add(pendingSample)) {
+            isFull = true;
+            break;
+        }
+        hasPendingSample = false;
+    }
+
+    if (encoder.getCount() == 0) return 0;
+    if (!isFull && timeNow - encoder.getFirstTimestamp() < TELEMETRY_MAX_LATENCY_MS * 1000UL) return 0;
+
+    // Built for a larger capacity than the transport takes now, the samples are lost
+    const uint16_t size = encoder.finish();
+    packetSequence++;
+    packetCapacity = 0;
+    if (size > capacity) return 0;
+
+    memcpy(buffer, packet, size);
+    return size;
+}
+
+uint32_t TelemetryStream::getDroppedSamples() {
+    return droppedSamples.load(std::memory_order_relaxed);
+}
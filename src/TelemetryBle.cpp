@@ -0,0 +1,83 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TelemetryBle.h"
+
+#ifdef USE_BLUETOOTH
+
+#include <utility/ATT.h>
+
+// Smallest ATT MTU, every central supports it
+#define ATT_DEFAULT_MTU 23
+
+TelemetryBle::TelemetryBle()
+    : service(TELEMETRY_SERVICE_UUID),
+      characteristic(TELEMETRY_CHARACTERISTIC_UUID, BLENotify, TELEMETRY_MAX_PACKET_SIZE) {
+}
+
+bool TelemetryBle::initialize() {
+    // Services must be in the GATT table before the device is advertised
+    BLE.stopAdvertise();
+    service.addCharacteristic(characteristic);
+    BLE.addService(service);
+    isInitialized = true;
+
+    return BLE.advertise() == 1;
+}
+
+uint16_t TelemetryBle::getPeerMtu() {
+    if (!ATT.connected(connectionHandle)) {
+        isMtuExchanged = false;
+        for (uint16_t handle = 0; handle < TELEMETRY_MAX_CONNECTION_HANDLE; handle++) {
+            if (ATT.connected(handle)) {
+                connectionHandle = handle;
+                break;
+            }
+        }
+    }
+    if (!ATT.connected(connectionHandle)) return ATT_DEFAULT_MTU;
+
+    // Many centrals never ask for more than 23 bytes, the request offers the largest MTU the controller takes
+    if (!isMtuExchanged) {
+        isMtuExchanged = true;
+        ATT.exchangeMtu(connectionHandle);
+    }
+    return ATT.mtu(connectionHandle);
+}
+
+void TelemetryBle::process(TelemetryStream& stream, uint32_t timeNow) {
+    if (!isInitialized) return;
+
+    // A new connection may get the handle of the last one
+    if (!BLE.connected()) isMtuExchanged = false;
+
+    if (!BLE.connected() || !characteristic.subscribed()) {
+        while (stream.readPacket(packet, sizeof(packet), timeNow) > 0) {
+        }
+        return;
+    }
+
+    // The notification carries MTU - 3 bytes, ATT cuts anything longer
+    const uint16_t mtu = getPeerMtu();
+    const uint16_t capacity = mtu > ATT_DEFAULT_MTU ? mtu - 3 : ATT_DEFAULT_MTU - 3;
+
+    for (uint8_t i = 0; i < TELEMETRY_MAX_PACKETS_PER_TICK; i++) {
+        const uint16_t size = stream.readPacket(packet, capacity, timeNow);
+        if (size == 0) return;
+        // Notifies the subscribed central
+        characteristic.writeValue(packet, size);
+    }
+}
+
+#endif  // USE_BLUETOOTH
@@ -0,0 +1,122 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TrackMap.h"
+
+bool TrackMap::initialize() {
+    segments = static_cast<TrackSegment*>(ps_malloc(TRACK_MAP_MAX_SEGMENTS * sizeof(TrackSegment)));
+    return segments != NULL;
+}
+
+void TrackMap::startRecording() {
+    clear();
+    if (segments == NULL) return;
+    state = RECORDING;
+}
+
+void TrackMap::record(float distance, float headingChange) {
+    if (state != RECORDING) return;
+
+    segmentDistance += distance;
+    segmentHeadingChange += headingChange;
+    if (segmentDistance < TRACK_MAP_SEGMENT_LENGTH_M) return;
+
+    if (numberOfSegments >= TRACK_MAP_MAX_SEGMENTS) {
+        hasOverflowed = true;
+        return;
+    }
+    segments[numberOfSegments].curvature = segmentHeadingChange / segmentDistance;
+    segments[numberOfSegments].speed = 0;
+    numberOfSegments++;
+
+    segmentDistance = 0;
+    segmentHeadingChange = 0;
+}
+
+bool TrackMap::finishRecording(float lapLength) {
+    if (state != RECORDING) return false;
+
+    const uint16_t lapSegments = lapLength / TRACK_MAP_SEGMENT_LENGTH_M;
+    if (numberOfSegments > lapSegments) numberOfSegments = lapSegments;
+
+    if (hasOverflowed || numberOfSegments < 2) {
+        clear();
+        return false;
+    }
+    plan();
+    state = READY;
+    return true;
+}
+
+void TrackMap::plan() {
+    const float segmentLength = TRACK_MAP_SEGMENT_LENGTH_M;
+
+    // Fastest speed each segment allows on its own, from the smoothed curvature
+    for (uint16_t i = 0; i < numberOfSegments; i++) {
+        float curvature = 0;
+        uint8_t numberOfNeighbours = 0;
+        for (int32_t j = int32_t(i) - TRACK_MAP_CURVATURE_SMOOTHING; j <= int32_t(i) + TRACK_MAP_CURVATURE_SMOOTHING; j++) {
+            if (j < 0 || j >= numberOfSegments) continue;
+            curvature += segments[j].curvature;
+            numberOfNeighbours++;
+        }
+        curvature = abs(curvature / numberOfNeighbours);
+
+        float speed = RACE_MAX_SPEED_M_S;
+        if (curvature > 0) {
+            const float cornerSpeed = sqrtf(RACE_MAX_LATERAL_ACCEL / curvature);
+            if (cornerSpeed < speed) speed = cornerSpeed;
+        }
+        segments[i].speed = speed;
+    }
+
+    // Brakes early enough to reach every slow segment in time
+    for (int32_t i = int32_t(numberOfSegments) - 2; i >= 0; i--) {
+        const float nextSpeed = segments[i + 1].speed;
+        const float reachableSpeed = sqrtf(nextSpeed * nextSpeed + 2 * RACE_MAX_BRAKING * segmentLength);
+        if (segments[i].speed > reachableSpeed) segments[i].speed = reachableSpeed;
+    }
+
+    // The robot can only speed up so fast, the first segment starts from the cruise speed
+    for (uint16_t i = 1; i < numberOfSegments; i++) {
+        const float previousSpeed = segments[i - 1].speed;
+        const float reachableSpeed = sqrtf(previousSpeed * previousSpeed + 2 * RACE_MAX_ACCELERATION * segmentLength);
+        if (segments[i].speed > reachableSpeed) segments[i].speed = reachableSpeed;
+    }
+}
+
+float TrackMap::getSpeedAt(float distance) {
+    if (state != READY) return 0;
+
+    int32_t index = distance / TRACK_MAP_SEGMENT_LENGTH_M;
+    if (index < 0) index = 0;
+    if (index >= numberOfSegments) index = numberOfSegments - 1;
+    return segments[index].speed;
+}
+
+void TrackMap::clear() {
+    numberOfSegments = 0;
+    hasOverflowed = false;
+    segmentDistance = 0;
+    segmentHeadingChange = 0;
+    state = EMPTY;
+}
+
+TrackMap::State TrackMap::getState() {
+    return state;
+}
+
+uint16_t TrackMap::getNumberOfSegments() {
+    return numberOfSegments;
+}
@@ -1,52 +1,22 @@
 #include <Arduino.h>
 
+#include "ControlLoop.h"
 #include "GlobalConsts.h"
 #include "Gyro.h"
 #include "LineFollower.h"
 #include "PIDestal.h"
 #include "PIDestalRemoteBLE.h"
+#include "Pins.h"
+#include "Profiler.h"
 #include "SensorArray.h"
+#include "Steering.h"
 #include "TB6612FNG.h"
 
-#define MIO 9
-#define MPLX_S0 13
-#define MPLX_S1 14
-#define MPLX_S2 21
-#define LED_SELEC_1 10
-#define LED_SELEC_2 12
-#define LEFT_HELPER_SENS 1
-#define RIGHT_HELPER_SENS 8
-
-#define SDA_PIN 16
-#define SCL_PIN 15
-
-#define STATUS_LED_1 41
-#define STATUS_LED_2 42
-#define INPUT_BTN_1 19
-#define INPUT_BTN_2 20
-
-#define PWM_A 38
-#define AIN_2 45
-#define AIN_1 48
-#define STBY 39
-#define BIN_1 5
-#define BIN_2 4
-#define PWM_B 2
-
 #define USE_ANALOG false
 #define LINE_COLOR WHITE  // BLACK | WHITE
 
-#if LINE_COLOR == WHITE
-#define HELPER_INTERRUPT_MODE FALLING
-#define HELPER_INTERRUPT_MODE_OFFLINE RISING
-
-#elif LINE_COLOR == BLACK
-#define HELPER_INTERRUPT_MODE RISING
-#define HELPER_INTERRUPT_MODE_OFFLINE FALLING
-
-#else
-#error "Invalid LINE_COLOR value"
-
+#if defined(USE_ANALOG_CENTROID) && !USE_ANALOG
+#error "USE_ANALOG_CENTROID requires USE_ANALOG"
 #endif
 
 // 12 até a squiggle
@@ -63,7 +33,7 @@ SensorArray mySens(
     SensorArray::LINE_COLOR,
     USE_ANALOG);
 
-Gyro myGyro;
+Gyro myGyro(GYRO_INT_PIN);
 
 Tb6612fng myMotors(
     STBY,
@@ -74,11 +44,16 @@ Tb6612fng myMotors(
     BIN_2,
     PWM_B);
 
-PIDestal sensorsPid(1.8, 0.001, 11);
-PIDestal gyroPid(0.90, 0.00001, 0.90);
+PIDestal sensorsPid(SENSOR_PID_KP, SENSOR_PID_KI, SENSOR_PID_KD);
+PIDestal gyroPid(GYRO_PID_KP, GYRO_PID_KI, GYRO_PID_KD);
 
 #ifdef USE_BLUETOOTH
-PIDestal* pidArray[] = {&sensorsPid, &gyroPid};
+// Copies edited by the BLE stack on the housekeeping core, LineFollower
+// forwards their gains to the control core through its mailbox
+PIDestal remoteSensorsPid = sensorsPid;
+PIDestal remoteGyroPid = gyroPid;
+
+PIDestal* pidArray[] = {&remoteSensorsPid, &remoteGyroPid};
 
 PIDestalRemoteBLE myRemotePid(pidArray, 2);
 #endif
@@ -91,12 +66,26 @@ LineFollower myLineFollower(
     myMotors,
 #ifdef USE_BLUETOOTH
     myRemotePid,
+    remoteSensorsPid,
+    remoteGyroPid,
 #endif
     STATUS_LED_1,
     STATUS_LED_2,
     INPUT_BTN_1,
     INPUT_BTN_2);
 
+void controlTick() {
+    myLineFollower.run();
+}
+
+void housekeepingTick() {
+    myLineFollower.runHousekeeping();
+}
+
+ControlLoop myControlLoop("control", controlTick, CONTROL_LOOP_RATE_HZ);
+ControlLoop myHousekeepingLoop("housekeeping", housekeepingTick, HOUSEKEEPING_RATE_HZ);
+
+// ArduinoBLE runs these from myRemotePid.process(), on the housekeeping task
 void startStop() {
     myLineFollower.toggleMotorsAreActive();
 }
@@ -111,19 +100,25 @@ void setFastMode() {
     myLineFollower.changeMode(LineFollower::FAST);
 }
 
-void leftSensInterruptOnLine() {
-    myLineFollower.triggeredInterruptFalling(LineFollower::LEFT);
+void setRaceMode() {
+    myLineFollower.changeMode(LineFollower::RACE);
 }
-void leftSensInterruptOffLine() {
-    myLineFollower.triggeredInterruptRising(LineFollower::LEFT);
+
+void clearTrackMap() {
+    myLineFollower.clearTrackMap();
+}
+
+void recalibrate() {
+    myLineFollower.requestCalibration();
 }
 
-void rightSensInterruptOnline() {
-    myLineFollower.triggeredInterruptFalling(LineFollower::RIGHT);
+// Both edges are queued, LineFollower filters them on the control task
+void IRAM_ATTR leftSensInterrupt() {
+    myLineFollower.onHelperEdge(LineFollower::LEFT, digitalRead(LEFT_HELPER_SENS), micros());
 }
 
-void rightSensInterruptOffline() {
-    myLineFollower.triggeredInterruptRising(LineFollower::RIGHT);
+void IRAM_ATTR rightSensInterrupt() {
+    myLineFollower.onHelperEdge(LineFollower::RIGHT, digitalRead(RIGHT_HELPER_SENS), micros());
 }
 
 void setup() {
@@ -138,16 +133,51 @@ void setup() {
 
     myLineFollower.initialize();
 
+#ifdef SENSOR_SCAN_BENCHMARK
+    mySens.benchmarkScan(1000);
+#endif
+
+#ifdef STEERING_BENCHMARK
+    benchmarkSteering(100);
+#endif
+
 #ifdef USE_BLUETOOTH
 
-    PIDestalRemoteBLE::FunctionPointer functions[] = {startStop, setSlowMode, setMediumMode, setFastMode};
+    PIDestalRemoteBLE::FunctionPointer functions[] = {startStop, setSlowMode, setMediumMode, setFastMode, recalibrate, setRaceMode, clearTrackMap};
 
-    myRemotePid.setCallbackFunctions(functions, 4);
+    myRemotePid.setCallbackFunctions(functions, 7);
+#endif
+    attachInterrupt(LEFT_HELPER_SENS, leftSensInterrupt, CHANGE);
+    attachInterrupt(RIGHT_HELPER_SENS, rightSensInterrupt, CHANGE);
+
+    if (!myControlLoop.begin(CONTROL_TASK_PRIORITY, CONTROL_TASK_CORE, CONTROL_TASK_STACK_SIZE)) {
+#ifdef SERIAL_DEBUG
+        Serial.println("Failed to start the control loop");
 #endif
-    attachInterrupt(LEFT_HELPER_SENS, leftSensInterruptOnLine, HELPER_INTERRUPT_MODE);
-    attachInterrupt(RIGHT_HELPER_SENS, rightSensInterruptOnline, HELPER_INTERRUPT_MODE);
+    }
+    if (!myHousekeepingLoop.begin(HOUSEKEEPING_TASK_PRIORITY, HOUSEKEEPING_TASK_CORE, HOUSEKEEPING_TASK_STACK_SIZE)) {
+#ifdef SERIAL_DEBUG
+        Serial.println("Failed to start the housekeeping loop");
+#endif
+    }
 }
 
 void loop() {
-    myLineFollower.run();
+#ifdef SERIAL_DEBUG
+    if (Serial.available()) {
+        const int serialCommand = Serial.read();
+
+        // 'd' dumps the last run in the binary format read by tools/decode_run.py
+        if (serialCommand == 'd') myLineFollower.dumpRunRecord(Serial);
+#ifdef ENABLE_PROFILER
+        // 'p' prints the per stage timing, 'r' resets it
+        if (serialCommand == 'p') Profiler::report(Serial);
+        if (serialCommand == 'r') Profiler::requestReset();
+#endif
+    }
+#endif
+    myControlLoop.printStats();
+    myHousekeepingLoop.printStats();
+    myGyro.printStats();
+    delay(1000);
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+    Simulates every mode on the stadium and on the bundled tracks and
+    checks that the firmware stops at the finish marker, never at a helper
+    sensor sweeping over the line
+
+    pio test -e native, from the project directory so sim/tracks is found
+*/
+
+#include <stdio.h>
+#include <unity.h>
+
+#include "Simulation.h"
+#include "Track.h"
+
+// Runs of each track and mode, the first centered and the rest from random poses
+#define RUNS_PER_MODE 3
+
+namespace {
+
+const LineFollower::Modes MODES[] = {LineFollower::SLOW, LineFollower::MEDIUM, LineFollower::FAST, LineFollower::RACE};
+const char* const MODE_NAMES[] = {"SLOW", "MEDIUM", "FAST", "RACE"};
+
+Track stadium;
+Track hairpin;
+Track corners;
+bool tracksAreLoaded = false;
+
+/*
+    Every run of every mode stops after the finish marker, except in
+    missingMode, where it may also drive past it but never stops early
+*/
+void checkEveryModeFinishes(const Track& track, int missingMode = -1) {
+    for (uint8_t i = 0; i < sizeof(MODES) / sizeof(MODES[0]); i++) {
+        for (uint32_t run = 1; run <= RUNS_PER_MODE; run++) {
+            SimulationConfig config;
+            config.track = &track;
+            config.mode = MODES[i];
+            randomizeStart(config, run);
+            const SimulationResult result = simulate(config);
+
+            char message[48];
+            snprintf(message, sizeof(message), "%s run %u", MODE_NAMES[i], unsigned(run));
+            TEST_ASSERT_FALSE_MESSAGE(result.stoppedEarly, message);
+            if (MODES[i] != missingMode) TEST_ASSERT_TRUE_MESSAGE(result.finished, message);
+            // The reported RACE lap replays the map of a finished mapping run
+            if (MODES[i] == LineFollower::RACE && result.finished) TEST_ASSERT_TRUE_MESSAGE(result.mappingLapTime >= 0, message);
+        }
+    }
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_stadium_finishes_in_every_mode() {
+    checkEveryModeFinishes(stadium);
+}
+
+void test_hairpin_finishes_in_every_mode() {
+    TEST_ASSERT_TRUE_MESSAGE(tracksAreLoaded, "sim/tracks not found");
+    checkEveryModeFinishes(hairpin);
+}
+
+/*
+    In FAST the bar loses the line at every corner and is still off it on
+    the finish marker, the right helper is then over the main line and the
+    marker is not counted
+*/
+void test_corners_finishes_except_in_fast() {
+    TEST_ASSERT_TRUE_MESSAGE(tracksAreLoaded, "sim/tracks not found");
+    checkEveryModeFinishes(corners, LineFollower::FAST);
+}
+
+int main(int argc, char** argv) {
+    stadium.buildStadium(2.0f, 0.5f);
+    tracksAreLoaded = hairpin.loadFile("sim/tracks/hairpin.txt") && corners.loadFile("sim/tracks/corners.txt");
+
+    UNITY_BEGIN();
+    RUN_TEST(test_stadium_finishes_in_every_mode);
+    RUN_TEST(test_hairpin_finishes_in_every_mode);
+    RUN_TEST(test_corners_finishes_except_in_fast);
+    return UNITY_END();
+}
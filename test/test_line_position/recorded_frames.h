@@ -0,0 +1,365 @@
+// Generated by tools/trace_frames.py, do not edit
+
+#ifndef RECORDED_FRAMES_H
+#define RECORDED_FRAMES_H
+
+#include <stdint.h>
+
+struct RecordedFrame {
+    // Bit i is the digital read of sensor i
+    uint8_t digital;
+    uint16_t analog[8];
+};
+
+const RecordedFrame RECORDED_FRAMES[] = {
+    // stadium.bin
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 936, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2765, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xfb, {3600, 3600, 400, 2127, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 1713, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2469, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 2663, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 2433, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3258, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2776, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2732, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 550, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 454, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2519, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3145, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1515, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1274, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2517, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1876, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2050, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1970, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1932, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2038, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2110, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1898, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2115, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1912, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2039, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2054, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1981, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2082, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1976, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2104, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1924, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2039, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2074, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1934, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2094, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1878, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2451, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2719, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2770, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2736, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2669, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2588, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2500, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2410, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2319, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2226, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2134, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2041, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2192, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2529, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2864, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3199, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3533, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3461, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3127, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 2793, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 2458, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 2123, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 1881, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 1699, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 1516, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 1333, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 1149, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 966, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 782, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 598, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 414, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 558, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 742, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 926, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 1110, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 1176, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 2672, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 1338, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 865, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 636, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 2806, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 761, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 1329, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1807, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3406, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3093, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2476, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1400, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3592, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1536, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1424, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3096, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2671, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1483, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2732, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1947, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2282, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1831, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2169, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2119, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2065, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2034, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1938, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2015, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2260, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2013, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1920, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2146, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2193, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1950, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2123, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1959, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1983, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2119, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2676, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 3600, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 3600, 400, 2846, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 931, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 1262, 400, 3600, 3600, 3600}},
+    {0xef, {3600, 3600, 3600, 3060, 400, 3600, 3600, 3600}},
+    {0xef, {3600, 3600, 3600, 3600, 400, 3176, 3600, 3600}},
+    {0xcf, {3600, 3600, 3600, 3600, 400, 1597, 3600, 3600}},
+    {0xcf, {3600, 3600, 3600, 3600, 400, 925, 3600, 3600}},
+    {0xcf, {3600, 3600, 3600, 3600, 400, 1014, 3600, 3600}},
+    {0xcf, {3600, 3600, 3600, 3600, 400, 1828, 3600, 3600}},
+    {0xef, {3600, 3600, 3600, 3600, 400, 2858, 3600, 3600}},
+    {0xef, {3600, 3600, 3600, 3600, 400, 3600, 3600, 3600}},
+    {0xef, {3600, 3600, 3600, 3200, 400, 3600, 3600, 3600}},
+    {0xef, {3600, 3600, 3600, 2298, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 1968, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 1884, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 1862, 400, 3600, 3600, 3600}},
+    // corners.bin
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xe7, {3600, 3600, 3600, 400, 400, 3600, 3600, 3600}},
+    {0xf7, {3600, 3600, 2301, 400, 3600, 3600, 3600, 3600}},
+    {0xf9, {2695, 400, 896, 3600, 3600, 3600, 3600, 3600}},
+    {0xfe, {1831, 3600, 3600, 3600, 3600, 3600, 3600, 3600}},
+    {0xff, {3600, 3600, 3600, 3600, 3600, 3600, 3600, 3600}},
+    {0xff, {3600, 3600, 3600, 3600, 3600, 3600, 3600, 3600}},
+    {0xff, {3600, 3600, 3600, 3600, 3600, 3600, 3600, 3600}},
+    {0xff, {3600, 3600, 3600, 3600, 3600, 3600, 3600, 3600}},
+    {0xff, {3600, 3600, 3600, 3600, 3600, 3600, 3600, 3600}},
+    {0xfe, {400, 3057, 3600, 3600, 3600, 3600, 3600, 3600}},
+    {0xf9, {3600, 400, 400, 3600, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 1822, 400, 3600, 3600, 3600, 3600}},
+    {0xcf, {3600, 3600, 3600, 3600, 400, 820, 3600, 3600}},
+    {0x9f, {3600, 3600, 3600, 3600, 3600, 476, 400, 3600}},
+    {0x3f, {3600, 3600, 3600, 3600, 3600, 3600, 400, 400}},
+    {0x7f, {3600, 3600, 3600, 3600, 3600, 3600, 2343, 400}},
+    {0x3f, {3600, 3600, 3600, 3600, 3600, 3600, 400, 400}},
+    {0xbf, {3600, 3600, 3600, 3600, 3600, 3253, 400, 3600}},
+    {0xdf, {3600, 3600, 3600, 3600, 3600, 400, 3427, 3600}},
+    {0xef, {3600, 3600, 3600, 3600, 400, 3371, 3600, 3600}},
+    {0xf7, {3600, 3600, 3508, 400, 3600, 3600, 3600, 3600}},
+    {0xfb, {3600, 3600, 400, 3365, 3600, 3600, 3600, 3600}},
+    {0xf9, {3600, 400, 400, 3600, 3600, 3600, 3600, 3600}},
+    {0xf9, {3600, 400, 400, 3600, 3600, 3600, 3600, 3600}},
+    {0xf9, {3600, 491, 400, 3600, 3600, 3600, 3600, 3600}},
+    {0xfb, {3600, 3600, 400, 2531, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+    {0xf3, {3600, 3600, 400, 400, 3600, 3600, 3600, 3600}},
+};
+
+#endif  // RECORDED_FRAMES_H
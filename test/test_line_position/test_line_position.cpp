@@ -0,0 +1,180 @@
+// Copyright 2023 Rafael Farias
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+    Compares the boolean line position with the analog centroid of
+    SensorArray on sensor frames recorded by the simulation, see
+    tools/trace_frames.py
+
+    pio test -e native
+*/
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "Pins.h"
+#include "SensorArray.h"
+#include "SensorPatterns.h"
+#include "SimHal.h"
+#include "recorded_frames.h"
+
+// The boolean position only moves in half sensor steps
+#define POSITION_TOLERANCE 0.5f
+
+#define N_OF_FRAMES (sizeof(RECORDED_FRAMES) / sizeof(RECORDED_FRAMES[0]))
+
+namespace {
+
+// Answers the sensor reads with the frame being tested
+class FrameBoard : public SimBoard {
+   public:
+    int readDigital(uint8_t pin) override {
+        if (pin == MIO) return frame->digital & (1 << selectedSensor()) ? HIGH : LOW;
+        return LOW;
+    }
+
+    uint16_t readAnalog(uint8_t pin) override {
+        if (pin == MIO) return frame->analog[selectedSensor()];
+        return 0;
+    }
+
+    int16_t readGyroZ() override { return 0; }
+    int16_t readAccelX() override { return 0; }
+    void drive(float leftOutput, float rightOutput) override {}
+    void brake() override {}
+    void coast() override {}
+
+    void advance(uint64_t micros) override {
+        simhal::setTime(simhal::now() + micros);
+    }
+
+    const RecordedFrame* frame = &RECORDED_FRAMES[0];
+
+   private:
+    uint8_t selectedSensor() {
+        const uint8_t channel = simhal::outputLevel(MPLX_S0) << 2 |
+                                simhal::outputLevel(MPLX_S1) << 1 |
+                                simhal::outputLevel(MPLX_S2);
+        return MPLX_CHANNEL_SENSOR[channel];
+    }
+};
+
+FrameBoard board;
+
+SensorArray digitalSensors(MIO, MPLX_S0, MPLX_S1, MPLX_S2, LED_SELEC_1, LED_SELEC_2, LEFT_HELPER_SENS, RIGHT_HELPER_SENS, SensorArray::WHITE, false);
+SensorArray analogSensors(MIO, MPLX_S0, MPLX_S1, MPLX_S2, LED_SELEC_1, LED_SELEC_2, LEFT_HELPER_SENS, RIGHT_HELPER_SENS, SensorArray::WHITE, true);
+
+// What each estimator made of a frame
+struct Estimate {
+    bool seesLine;
+    float position;
+};
+
+Estimate booleanEstimate(size_t frameIndex) {
+    board.frame = &RECORDED_FRAMES[frameIndex];
+    digitalSensors.updateSensorsArray(simhal::now());
+
+    // As LineFollower::calculateInput
+    const SensorPattern& pattern = SENSOR_PATTERNS[digitalSensors.processedMask];
+    return Estimate{pattern.activeSensors > 0, pattern.position};
+}
+
+// Some sensor of the frame is only partly over the line
+bool isLineEdgeFrame(size_t frameIndex) {
+    uint16_t minReads[N_OF_SENSORS], maxReads[N_OF_SENSORS], thresholds[N_OF_SENSORS];
+    analogSensors.getCalibration(minReads, maxReads, thresholds);
+
+    for (uint8_t i = 0; i < N_OF_SENSORS; i++) {
+        const uint16_t reading = RECORDED_FRAMES[frameIndex].analog[i];
+        if (reading > minReads[i] && reading < maxReads[i]) return true;
+    }
+    return false;
+}
+
+Estimate centroidEstimate(size_t frameIndex) {
+    board.frame = &RECORDED_FRAMES[frameIndex];
+    analogSensors.updateSensorsArray(simhal::now());
+
+    Estimate estimate = {false, 0};
+    estimate.seesLine = analogSensors.calculateCentroid(estimate.position);
+    return estimate;
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_both_see_the_line_on_the_same_frames() {
+    size_t edgeDisagreements = 0;
+    for (size_t i = 0; i < N_OF_FRAMES; i++) {
+        if (booleanEstimate(i).seesLine == centroidEstimate(i).seesLine) continue;
+
+        // A sensor barely over the line is below CENTROID_MIN_WEIGHT but past the digital threshold
+        char message[32];
+        snprintf(message, sizeof(message), "frame %u", unsigned(i));
+        TEST_ASSERT_TRUE_MESSAGE(isLineEdgeFrame(i), message);
+        edgeDisagreements++;
+    }
+    TEST_ASSERT_TRUE(edgeDisagreements * 50 <= N_OF_FRAMES);
+}
+
+void test_positions_agree_within_half_a_sensor() {
+    for (size_t i = 0; i < N_OF_FRAMES; i++) {
+        const Estimate boolean = booleanEstimate(i);
+        const Estimate centroid = centroidEstimate(i);
+        if (!boolean.seesLine || !centroid.seesLine) continue;
+
+        char message[32];
+        snprintf(message, sizeof(message), "frame %u", unsigned(i));
+        TEST_ASSERT_FLOAT_WITHIN_MESSAGE(POSITION_TOLERANCE, boolean.position, centroid.position, message);
+        TEST_ASSERT_TRUE_MESSAGE(centroid.position >= 0 && centroid.position <= N_OF_SENSORS - 1, message);
+    }
+}
+
+void test_positions_match_with_the_line_under_whole_sensors() {
+    for (size_t i = 0; i < N_OF_FRAMES; i++) {
+        if (isLineEdgeFrame(i)) continue;
+        const Estimate boolean = booleanEstimate(i);
+        const Estimate centroid = centroidEstimate(i);
+        if (!boolean.seesLine) continue;
+
+        // Every sensor on the line weighs the same, the centroid is the mean index
+        char message[32];
+        snprintf(message, sizeof(message), "frame %u", unsigned(i));
+        TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1.0f / 256, boolean.position, centroid.position, message);
+    }
+}
+
+int main(int argc, char** argv) {
+    simhal::attach(&board);
+    digitalSensors.initialize();
+    analogSensors.initialize();
+
+    // Calibration sweep over every recorded frame, as the robot does over the line
+    analogSensors.resetCalibration();
+    for (size_t i = 0; i < N_OF_FRAMES; i++) {
+        board.frame = &RECORDED_FRAMES[i];
+        analogSensors.calibrateSensors(simhal::now());
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_both_see_the_line_on_the_same_frames);
+    RUN_TEST(test_positions_agree_within_half_a_sensor);
+    RUN_TEST(test_positions_match_with_the_line_under_whole_sensors);
+    const int failures = UNITY_END();
+
+    simhal::detach();
+    return failures;
+}
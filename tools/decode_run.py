@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+# Copyright 2023 Rafael Farias
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Decodes a run recorder dump (see include/RunRecorder.h) into CSV.
+
+Capture the dump straight from the robot:
+    python tools/decode_run.py --port /dev/ttyUSB0 run.csv
+
+Or decode a file that already holds the raw serial output:
+    python tools/decode_run.py capture.bin run.csv
+
+Fit the yaw rate model of the slip detector (see include/SlipDetector.h):
+    python tools/decode_run.py capture.bin --fit-slip
+"""
+
+import argparse
+import csv
+import math
+import struct
+import sys
+import zlib
+
+MAGIC = b"VDRR"
+VERSION = 1
+N_OF_SENSORS = 8
+
+HEADER = struct.Struct("<4sHHII")
+RECORD = struct.Struct("<I%dHBBH6f" % N_OF_SENSORS)
+
+FLAG_GYRO_CONTROLLER = 1 << 0
+FLAG_OUT_OF_LINE = 1 << 1
+FLAG_LEFT_HELPER = 1 << 2
+FLAG_RIGHT_HELPER = 1 << 3
+FLAG_SLIP = 1 << 4
+
+COLUMNS = (
+    ["timestamp"]
+    + ["raw%d" % i for i in range(N_OF_SENSORS)]
+    + ["processed%d" % i for i in range(N_OF_SENSORS)]
+    + [
+        "controller",
+        "outOfLine",
+        "leftHelper",
+        "rightHelper",
+        "slip",
+        "sensorInput",
+        "rotSpeed",
+        "sensorPidResult",
+        "gyroPidResult",
+        "leftMotorOutput",
+        "rightMotorOutput",
+    ]
+)
+
+
+def decode(data):
+    """Returns (records, overwritten) from a buffer holding one dump."""
+    start = data.find(MAGIC)
+    if start < 0:
+        raise ValueError("no dump found")
+
+    magic, version, record_size, count, overwritten = HEADER.unpack_from(data, start)
+    if version != VERSION:
+        raise ValueError("unsupported dump version %d" % version)
+    if record_size != RECORD.size:
+        raise ValueError("record size %d, expected %d" % (record_size, RECORD.size))
+
+    body_start = start + HEADER.size
+    body_end = body_start + count * record_size
+    if len(data) < body_end + 4:
+        raise ValueError("dump is truncated")
+
+    body = data[body_start:body_end]
+    (crc,) = struct.unpack_from("<I", data, body_end)
+    if zlib.crc32(body) != crc:
+        raise ValueError("CRC mismatch")
+
+    records = []
+    for fields in RECORD.iter_unpack(body):
+        timestamp = fields[0]
+        raw = list(fields[1 : 1 + N_OF_SENSORS])
+        processed_mask, flags, _ = fields[1 + N_OF_SENSORS : 4 + N_OF_SENSORS]
+        values = list(fields[4 + N_OF_SENSORS :])
+        processed = [(processed_mask >> i) & 1 for i in range(N_OF_SENSORS)]
+        records.append(
+            [timestamp]
+            + raw
+            + processed
+            + [
+                "GYRO" if flags & FLAG_GYRO_CONTROLLER else "SENSOR",
+                int(bool(flags & FLAG_OUT_OF_LINE)),
+                int(bool(flags & FLAG_LEFT_HELPER)),
+                int(bool(flags & FLAG_RIGHT_HELPER)),
+                int(bool(flags & FLAG_SLIP)),
+            ]
+            + values
+        )
+    return records, overwritten
+
+
+def fit_slip(records):
+    """Least squares fit of rotSpeed[k] = a * rotSpeed[k-1] + b * (right - left)[k-1] over the ticks without slip.
+
+    Returns (gain, time_constant, residuals), the residuals are the ones the
+    slip detector would have seen with the fitted model outside of slips.
+    """
+    timestamp = COLUMNS.index("timestamp")
+    slip = COLUMNS.index("slip")
+    rot_speed = COLUMNS.index("rotSpeed")
+    left = COLUMNS.index("leftMotorOutput")
+    right = COLUMNS.index("rightMotorOutput")
+
+    periods = sorted((later[timestamp] - earlier[timestamp]) & 0xFFFFFFFF for earlier, later in zip(records, records[1:]))
+    if not periods:
+        raise ValueError("not enough records to fit")
+    period = periods[len(periods) // 2]
+
+    syy = syu = suu = sy1y = sy1u = 0.0
+    for earlier, later in zip(records, records[1:]):
+        # Skipped ticks and slipping wheels do not follow the model
+        if (later[timestamp] - earlier[timestamp]) & 0xFFFFFFFF > period * 3 // 2:
+            continue
+        if earlier[slip] or later[slip]:
+            continue
+        y = earlier[rot_speed]
+        u = earlier[right] - earlier[left]
+        syy += y * y
+        syu += y * u
+        suu += u * u
+        sy1y += later[rot_speed] * y
+        sy1u += later[rot_speed] * u
+
+    determinant = syy * suu - syu * syu
+    if determinant == 0:
+        raise ValueError("the outputs never changed, nothing to fit")
+    a = (sy1y * suu - sy1u * syu) / determinant
+    b = (sy1u * syy - sy1y * syu) / determinant
+    if not 0 < a < 1:
+        raise ValueError("fitted pole %.4f is not a first order lag" % a)
+
+    gain = b / (1 - a)
+    time_constant = -period / 1e6 / math.log(a)
+
+    # Same recursion as SlipDetector::update
+    alpha = 1 - a
+    expected = 0.0
+    residuals = []
+    for earlier, later in zip(records, records[1:]):
+        expected += alpha * (gain * (earlier[right] - earlier[left]) - expected)
+        if not later[slip]:
+            residuals.append(expected - later[rot_speed])
+    return gain, time_constant, residuals
+
+
+def print_slip_fit(records):
+    gain, time_constant, residuals = fit_slip(records)
+    magnitudes = sorted(abs(residual) for residual in residuals)
+    rms = math.sqrt(sum(residual * residual for residual in residuals) / len(residuals))
+    percentile = magnitudes[int(len(magnitudes) * 0.99)]
+    print("#define SLIP_YAW_GAIN %.1ff" % gain)
+    print("#define SLIP_TIME_CONSTANT_S %.4ff" % time_constant)
+    print("// residual rms %.2f, 99th percentile %.2f, SLIP_MIN_RESIDUAL should sit above it" % (rms, percentile))
+
+
+def capture(port, baudrate, timeout):
+    import serial  # pyserial, only needed to capture
+
+    with serial.Serial(port, baudrate, timeout=timeout) as connection:
+        connection.reset_input_buffer()
+        connection.write(b"d")
+        data = bytearray()
+        while True:
+            chunk = connection.read(65536)
+            if not chunk:
+                # Nothing more is coming, let decode() report what is wrong
+                return bytes(data)
+            data += chunk
+
+            # The robot keeps printing its statistics after the dump
+            start = data.find(MAGIC)
+            if start >= 0 and len(data) >= start + HEADER.size:
+                count = HEADER.unpack_from(data, start)[3]
+                if len(data) >= start + HEADER.size + count * RECORD.size + 4:
+                    return bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="file holding the raw dump")
+    parser.add_argument("output", nargs="?", help="CSV file to write, - for stdout")
+    parser.add_argument("--port", help="serial port to request the dump from")
+    parser.add_argument("--baudrate", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=5.0, help="seconds of silence that abort the capture")
+    parser.add_argument("--fit-slip", action="store_true", help="prints the slip detector constants fitted to the run")
+    args = parser.parse_args()
+    if args.port and args.output is None:
+        # Only the output file is given when capturing
+        args.output, args.input = args.input, None
+    if args.output is None and not args.fit_slip:
+        parser.error("an output file is needed")
+
+    if args.port:
+        data = capture(args.port, args.baudrate, args.timeout)
+    elif args.input:
+        with open(args.input, "rb") as input_file:
+            data = input_file.read()
+    else:
+        parser.error("either an input file or --port is needed")
+
+    records, overwritten = decode(data)
+    if args.fit_slip:
+        print_slip_fit(records)
+    if args.output is None:
+        return
+
+    output_file = sys.stdout if args.output == "-" else open(args.output, "w", newline="")
+    writer = csv.writer(output_file)
+    writer.writerow(COLUMNS)
+    writer.writerows(records)
+    if output_file is not sys.stdout:
+        output_file.close()
+
+    print("%d records, %d overwritten" % (len(records), overwritten), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
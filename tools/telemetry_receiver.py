@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+# Copyright 2023 Rafael Farias
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Reassembles the telemetry stream (see include/Telemetry.h) into CSV.
+
+Stream from the robot over BLE, needs bleak:
+    python tools/telemetry_receiver.py --ble VINHO_DIESEL telemetry.csv
+
+Decode the packets written by the simulation with --telemetry:
+    python tools/telemetry_receiver.py --file telemetry.bin telemetry.csv
+
+Receive packets sent as UDP datagrams, a local stand-in for the BLE link:
+    python tools/telemetry_receiver.py --udp 9870 telemetry.csv
+
+Check the decoder against the encoder over a loopback UDP link, replaying
+a simulation capture or, without --file, synthetic samples:
+    python tools/telemetry_receiver.py --loopback [--file telemetry.bin]
+"""
+
+import argparse
+import csv
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+
+VERSION = 1
+N_OF_CHANNELS = 6
+CHANNELS = [
+    "sensorInput",
+    "rotSpeed",
+    "sensorPidResult",
+    "gyroPidResult",
+    "leftMotorOutput",
+    "rightMotorOutput",
+]
+# TELEMETRY_CHANNEL_SCALE
+SCALES = [1000, 100, 100, 100, 10000, 10000]
+
+HEADER = struct.Struct("<BHB")
+FIRST_SAMPLE = struct.Struct("<I%dh" % N_OF_CHANNELS)
+
+SERVICE_UUID = "6b1c0001-52a4-4b5e-9a7e-3f0d2c8e7a10"
+CHARACTERISTIC_UUID = "6b1c0002-52a4-4b5e-9a7e-3f0d2c8e7a10"
+
+COLUMNS = ["time", "timestamp"] + CHANNELS
+
+
+def read_varint(data, offset):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, offset
+        shift += 7
+
+
+def write_varint(value):
+    output = bytearray()
+    while value >= 0x80:
+        output.append((value & 0x7F) | 0x80)
+        value >>= 7
+    output.append(value)
+    return output
+
+
+def decode_packet(packet):
+    """Returns (sequence, samples), each sample is [timestamp] + quantized channels."""
+    version, sequence, count = HEADER.unpack_from(packet, 0)
+    if version != VERSION:
+        raise ValueError("unsupported packet version %d" % version)
+    if count == 0:
+        return sequence, []
+
+    offset = HEADER.size
+    sample = list(FIRST_SAMPLE.unpack_from(packet, offset))
+    offset += FIRST_SAMPLE.size
+    samples = [sample]
+    for _ in range(count - 1):
+        delta, offset = read_varint(packet, offset)
+        sample = [(sample[0] + delta) & 0xFFFFFFFF] + sample[1:]
+        for i in range(N_OF_CHANNELS):
+            zigzag, offset = read_varint(packet, offset)
+            sample[1 + i] += (zigzag >> 1) ^ -(zigzag & 1)
+        samples.append(list(sample))
+    if offset != len(packet):
+        raise ValueError("%d bytes left after the last sample" % (len(packet) - offset))
+    return sequence, samples
+
+
+def encode_packet(sequence, samples):
+    """Same packing as TelemetryEncoder, only used by the loopback stand-in."""
+    packet = bytearray(HEADER.pack(VERSION, sequence & 0xFFFF, len(samples)))
+    packet += FIRST_SAMPLE.pack(*samples[0])
+    for last, sample in zip(samples, samples[1:]):
+        packet += write_varint((sample[0] - last[0]) & 0xFFFFFFFF)
+        for i in range(1, 1 + N_OF_CHANNELS):
+            delta = sample[i] - last[i]
+            packet += write_varint(((delta << 1) ^ (delta >> 31)) & 0xFFFFFFFF)
+    return bytes(packet)
+
+
+class Reassembler:
+    """Turns packets into timestamped samples, counting the lost packets."""
+
+    def __init__(self):
+        self.samples = []
+        self.lost_packets = 0
+        self._next_sequence = None
+        self._last_timestamp = None
+        self._timestamp_offset = 0
+
+    def add(self, packet):
+        sequence, samples = decode_packet(packet)
+        if self._next_sequence is not None:
+            self.lost_packets += (sequence - self._next_sequence) & 0xFFFF
+        self._next_sequence = (sequence + 1) & 0xFFFF
+
+        for sample in samples:
+            # micros() wraps every 71 minutes
+            if self._last_timestamp is not None and sample[0] < self._last_timestamp:
+                self._timestamp_offset += 1 << 32
+            self._last_timestamp = sample[0]
+            timestamp = sample[0] + self._timestamp_offset
+            values = [value / scale for value, scale in zip(sample[1:], SCALES)]
+            self.samples.append([timestamp / 1e6, timestamp] + values)
+
+
+def read_packet_file(path):
+    """Packets written by the simulation, each after its uint16 size."""
+    with open(path, "rb") as packet_file:
+        data = packet_file.read()
+    packets = []
+    offset = 0
+    while offset + 2 <= len(data):
+        (size,) = struct.unpack_from("<H", data, offset)
+        offset += 2
+        if offset + size > len(data):
+            raise ValueError("packet file is truncated")
+        packets.append(data[offset : offset + size])
+        offset += size
+    return packets
+
+
+def receive_udp(reassembler, port, timeout):
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as receiver:
+        receiver.bind(("127.0.0.1", port))
+        receiver.settimeout(timeout)
+        try:
+            while True:
+                reassembler.add(receiver.recv(65535))
+        except (socket.timeout, KeyboardInterrupt):
+            pass
+
+
+def receive_ble(reassembler, name, duration):
+    import asyncio
+
+    from bleak import BleakClient, BleakScanner  # only needed to stream from the robot
+
+    async def stream():
+        device = await BleakScanner.find_device_by_name(name)
+        if device is None:
+            raise RuntimeError("%s not found" % name)
+        async with BleakClient(device) as client:
+            print("connected, MTU %d" % client.mtu_size, file=sys.stderr)
+            await client.start_notify(CHARACTERISTIC_UUID, lambda _, data: reassembler.add(bytes(data)))
+            try:
+                await asyncio.sleep(duration)
+            finally:
+                await client.stop_notify(CHARACTERISTIC_UUID)
+
+    try:
+        asyncio.run(stream())
+    except KeyboardInterrupt:
+        pass
+
+
+def synthetic_packets(count, samples_per_packet):
+    """Returns (packets, samples), a random walk of every channel with micros() wrapping halfway."""
+    generator = random.Random(1)
+    timestamp = ((1 << 32) - 5000 * count * samples_per_packet // 2) & 0xFFFFFFFF
+    values = [0] * N_OF_CHANNELS
+    packets = []
+    samples = []
+    for sequence in range(count):
+        packet_samples = []
+        for _ in range(samples_per_packet):
+            timestamp = (timestamp + 5000) & 0xFFFFFFFF
+            values = [max(-32768, min(32767, value + generator.randint(-3000, 3000))) for value in values]
+            packet_samples.append([timestamp] + values)
+        packets.append(encode_packet(sequence, packet_samples))
+        samples += packet_samples
+    return packets, samples
+
+
+def loopback(packets, samples=None):
+    """Sends packets to a local UDP receiver, dropping every tenth, and checks what comes back."""
+    sent = [packet for index, packet in enumerate(packets) if index % 10 != 9]
+    # A drop is only noticed once a later packet arrives
+    detectable = sum(1 for index in range(len(packets)) if index % 10 == 9 and index < len(packets) - 1)
+
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as receiver:
+        receiver.bind(("127.0.0.1", 0))
+        receiver.settimeout(2.0)
+        port = receiver.getsockname()[1]
+
+        def send():
+            with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sender:
+                for packet in sent:
+                    sender.sendto(packet, ("127.0.0.1", port))
+                    # Paced like notifications on a BLE connection, a burst overflows the socket buffer
+                    time.sleep(0.001)
+
+        sender_thread = threading.Thread(target=send)
+        sender_thread.start()
+        received = Reassembler()
+        for _ in sent:
+            received.add(receiver.recv(65535))
+        sender_thread.join()
+
+    expected = Reassembler()
+    for packet in sent:
+        expected.add(packet)
+    if received.samples != expected.samples:
+        raise AssertionError("samples changed over the loopback")
+    if received.lost_packets != detectable:
+        raise AssertionError("%d lost packets reported, %d dropped" % (received.lost_packets, detectable))
+
+    if samples is not None:
+        # Every packet decoded, against what was encoded
+        decoded = [sample for packet in packets for sample in decode_packet(packet)[1]]
+        if decoded != samples:
+            raise AssertionError("decoded samples differ from the encoded ones")
+
+    timestamps = [sample[1] for sample in received.samples]
+    if any(later <= earlier for earlier, later in zip(timestamps, timestamps[1:])):
+        raise AssertionError("timestamps are not increasing")
+
+    print(
+        "loopback ok: %d packets, %d samples, %d lost packets detected"
+        % (len(sent), len(received.samples), received.lost_packets),
+        file=sys.stderr,
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("output", nargs="?", help="CSV file to write, - for stdout")
+    source = parser.add_mutually_exclusive_group()
+    source.add_argument("--ble", metavar="NAME", help="BLE name of the robot")
+    source.add_argument("--udp", metavar="PORT", type=int, help="local UDP port to receive packets on")
+    parser.add_argument("--file", help="packet file written by the simulation")
+    parser.add_argument("--loopback", action="store_true", help="self test over a local UDP link")
+    parser.add_argument("--duration", type=float, default=60.0, help="seconds to stream over BLE")
+    parser.add_argument("--timeout", type=float, default=5.0, help="seconds of UDP silence that end the capture")
+    args = parser.parse_args()
+
+    if args.loopback:
+        if args.file:
+            loopback(read_packet_file(args.file))
+        else:
+            loopback(*synthetic_packets(200, 20))
+        return
+    if args.output is None:
+        parser.error("an output file is needed")
+
+    reassembler = Reassembler()
+    if args.ble:
+        receive_ble(reassembler, args.ble, args.duration)
+    elif args.udp:
+        receive_udp(reassembler, args.udp, args.timeout)
+    elif args.file:
+        for packet in read_packet_file(args.file):
+            reassembler.add(packet)
+    else:
+        parser.error("one of --ble, --udp or --file is needed")
+
+    output_file = sys.stdout if args.output == "-" else open(args.output, "w", newline="")
+    writer = csv.writer(output_file)
+    writer.writerow(COLUMNS)
+    writer.writerows(reassembler.samples)
+    if output_file is not sys.stdout:
+        output_file.close()
+
+    print("%d samples, %d packets lost" % (len(reassembler.samples), reassembler.lost_packets), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
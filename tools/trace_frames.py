@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# Copyright 2023 Rafael Farias
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Extracts the sensor frames of simulation traces (see sim/Trace.h) into a C header.
+
+Regenerate the frames of the line position test:
+    .pio/build/native/program --mode medium --record stadium.bin
+    .pio/build/native/program --track sim/tracks/corners.txt --mode fast --record corners.bin
+    python tools/trace_frames.py stadium.bin corners.bin test/test_line_position/recorded_frames.h
+"""
+
+import argparse
+import struct
+
+MAGIC = b"LFTR"
+VERSION = 1
+N_OF_SENSORS = 8
+TRACE_CONTROL_TICK = 0
+
+HEADER = struct.Struct("<4sHHB3x")
+EVENT = struct.Struct("<QBBBB%dHhhB3xff" % N_OF_SENSORS)
+
+
+def read_frames(path):
+    """Returns (digital mask, analog readings) of every control tick."""
+    with open(path, "rb") as trace_file:
+        data = trace_file.read()
+    magic, version, event_size, _ = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION or event_size != EVENT.size:
+        raise ValueError("%s is not a version %d trace" % (path, VERSION))
+
+    frames = []
+    for offset in range(HEADER.size, len(data) - EVENT.size + 1, EVENT.size):
+        event = EVENT.unpack_from(data, offset)
+        if event[1] == TRACE_CONTROL_TICK:
+            frames.append((event[4], event[5 : 5 + N_OF_SENSORS]))
+    return frames
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("traces", nargs="+", help="traces written with --record")
+    parser.add_argument("output", help="header to write")
+    parser.add_argument("--every", type=int, default=20, help="keeps one control tick in this many")
+    args = parser.parse_args()
+
+    lines = []
+    for path in args.traces:
+        frames = read_frames(path)[:: args.every]
+        lines.append("    // %s" % path.replace("\\", "/").split("/")[-1])
+        for mask, analog in frames:
+            lines.append("    {0x%02x, {%s}}," % (mask, ", ".join(str(value) for value in analog)))
+
+    with open(args.output, "w") as output:
+        output.write("// Generated by tools/trace_frames.py, do not edit\n\n")
+        output.write("#ifndef RECORDED_FRAMES_H\n#define RECORDED_FRAMES_H\n\n")
+        output.write("#include <stdint.h>\n\n")
+        output.write("struct RecordedFrame {\n")
+        output.write("    // Bit i is the digital read of sensor i\n")
+        output.write("    uint8_t digital;\n")
+        output.write("    uint16_t analog[%d];\n};\n\n" % N_OF_SENSORS)
+        output.write("const RecordedFrame RECORDED_FRAMES[] = {\n")
+        output.write("\n".join(lines))
+        output.write("\n};\n\n#endif  // RECORDED_FRAMES_H\n")
+
+
+if __name__ == "__main__":
+    main()